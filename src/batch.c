@@ -0,0 +1,409 @@
+#include "batch.h"
+#include "log.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+  char *id;
+  char *rom_path;
+  char *input_path;
+  char *output_path;
+  char *until;
+  uint64_t max_frames;
+  uint64_t max_cycles;
+  uint64_t hash_interval;
+  uint64_t warmup_frames;
+  uint32_t line;            // Manifest line, breaks ties when jobs are ordered
+  GB_rom_t *rom;            // Shared by every job of the same ROM path
+  uint8_t rom_sha1[GB_HASH_SHA1_SIZE];  // Hashed once per ROM, only with a state cache
+} batch_job_t;
+
+typedef struct {
+  batch_job_t *jobs;
+  size_t count;
+  size_t capacity;
+  FILE *results;
+  pthread_mutex_t results_mutex;
+  GB_rtc_source_t rtc_source;
+  bool skip_boot;
+  GB_state_cache_t state_cache;
+  bool state_cache_enabled;
+  uint32_t failed_count;    // Guarded by results_mutex, as is cpu_seconds
+  double cpu_seconds;
+} batch_t;
+
+static double get_time_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *skip_spaces(const char *text) {
+  while (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n') { text++; }
+  return text;
+}
+
+static const char *parse_string(const char *text, char **out) {
+  // Escapes are decoded, \u only for ASCII which covers ids and paths
+  if (*text++ != '"') { return NULL; }
+
+  char *value = malloc(strlen(text) + 1);
+  if (!value) { return NULL; }
+
+  size_t length = 0;
+  while (*text && *text != '"') {
+    char c = *text++;
+    if (c == '\\') {
+      c = *text++;
+      switch (c) {
+        case '"': case '\\': case '/': break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'u': {
+          unsigned code = 0;
+          for (uint8_t i = 0; i < 4; i++) {
+            if (!isxdigit((unsigned char)text[i])) { code = 0; break; }
+            code = code * 16 + (isdigit((unsigned char)text[i]) ? text[i] - '0' : (tolower((unsigned char)text[i]) - 'a' + 10));
+          }
+          if (code == 0 || code > 0x7F) {
+            free(value);
+            return NULL;
+          }
+          text += 4;
+          c = (char)code;
+          break;
+        }
+        default:
+          free(value);
+          return NULL;
+      }
+    }
+    value[length++] = c;
+  }
+  if (*text != '"') {
+    free(value);
+    return NULL;
+  }
+  value[length] = '\0';
+  *out = value;
+
+  return text + 1;
+}
+
+static const char *parse_number(const char *text, uint64_t *out) {
+  if (!isdigit((unsigned char)*text)) { return NULL; }
+
+  char *end;
+  *out = strtoull(text, &end, 10);
+
+  return end;
+}
+
+static char **string_field(batch_job_t *job, const char *key) {
+  if (!strcmp(key, "id"))     { return &job->id; }
+  if (!strcmp(key, "rom"))    { return &job->rom_path; }
+  if (!strcmp(key, "input"))  { return &job->input_path; }
+  if (!strcmp(key, "output")) { return &job->output_path; }
+  if (!strcmp(key, "until"))  { return &job->until; }
+  return NULL;
+}
+
+static uint64_t *number_field(batch_job_t *job, const char *key) {
+  if (!strcmp(key, "frames"))        { return &job->max_frames; }
+  if (!strcmp(key, "cycles"))        { return &job->max_cycles; }
+  if (!strcmp(key, "hash_interval")) { return &job->hash_interval; }
+  if (!strcmp(key, "warmup"))        { return &job->warmup_frames; }
+  return NULL;
+}
+
+static bool parse_job(const char *line, batch_job_t *job) {
+  // Flat object of strings and unsigned numbers, unknown keys are ignored
+  const char *text = skip_spaces(line);
+  if (*text++ != '{') { return false; }
+
+  text = skip_spaces(text);
+  while (*text != '}') {
+    char *key = NULL;
+    text = parse_string(text, &key);
+    if (!text) { return false; }
+
+    text = skip_spaces(text);
+    if (*text++ != ':') {
+      free(key);
+      return false;
+    }
+    text = skip_spaces(text);
+
+    char **string = string_field(job, key);
+    uint64_t *number = number_field(job, key);
+    if (*text == '"') {
+      char *value = NULL;
+      text = number ? NULL : parse_string(text, &value);
+      if (string) {
+        free(*string);
+        *string = value;
+      } else {
+        free(value);
+      }
+    } else {
+      uint64_t value = 0;
+      text = string ? NULL : parse_number(text, &value);
+      if (number) { *number = value; }
+    }
+    free(key);
+    if (!text) { return false; }
+
+    text = skip_spaces(text);
+    if (*text == ',') {
+      text = skip_spaces(text + 1);
+    } else if (*text != '}') {
+      return false;
+    }
+  }
+
+  return *skip_spaces(text + 1) == '\0' && job->rom_path;
+}
+
+static void free_job(batch_job_t *job) {
+  free(job->id);
+  free(job->rom_path);
+  free(job->input_path);
+  free(job->output_path);
+  free(job->until);
+  GB_rom_release(job->rom);
+}
+
+static bool load_manifest(const char *path, const batch_config_t *config, batch_t *batch) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    LOG_ERROR("failed to open manifest %s.", path);
+    return false;
+  }
+
+  char *line = NULL;
+  size_t line_capacity = 0;
+  uint32_t line_number = 0;
+  bool valid = true;
+  while (valid && getline(&line, &line_capacity, file) >= 0) {
+    line_number++;
+    if (*skip_spaces(line) == '\0') { continue; }  // Blank line
+
+    if (batch->count == batch->capacity) {
+      const size_t capacity = batch->capacity ? batch->capacity * 2 : 64;
+      batch_job_t *jobs = realloc(batch->jobs, capacity * sizeof(batch_job_t));
+      if (!jobs) {
+        LOG_ERROR("out of memory.");
+        valid = false;
+        break;
+      }
+      batch->jobs = jobs;
+      batch->capacity = capacity;
+    }
+
+    batch_job_t *job = &batch->jobs[batch->count++];
+    *job = (batch_job_t){ .hash_interval = config->hash_interval, .warmup_frames = config->warmup_frames, .line = line_number };
+    valid = parse_job(line, job);
+    if (!valid) {
+      LOG_ERROR("invalid job at %s:%u.", path, line_number);
+      break;
+    }
+
+    if (!job->id) {
+      char id[16];
+      snprintf(id, sizeof(id), "%u", line_number);
+      job->id = strdup(id);
+    }
+    if (job->max_frames == 0 && job->max_cycles == 0) {
+      job->max_frames = config->default_frames;
+      job->max_cycles = config->default_cycles;
+    }
+  }
+  free(line);
+  fclose(file);
+
+  return valid;
+}
+
+static void load_roms(batch_t *batch) {
+  // Every distinct ROM is loaded and hashed once, a ROM that fails to load is reported by each of its jobs
+  for (size_t i = 0; i < batch->count; i++) {
+    batch_job_t *job = &batch->jobs[i];
+    size_t first = 0;
+    while (strcmp(batch->jobs[first].rom_path, job->rom_path)) { first++; }
+
+    if (first < i) {
+      job->rom = GB_rom_retain(batch->jobs[first].rom);
+      memcpy(job->rom_sha1, batch->jobs[first].rom_sha1, GB_HASH_SHA1_SIZE);
+    } else if (GB_FAILED(GB_rom_load(&job->rom, job->rom_path))) {
+      job->rom = NULL;
+    } else if (batch->state_cache_enabled) {
+      GB_hash_sha1(job->rom->data, job->rom->size, job->rom_sha1);
+    }
+  }
+}
+
+static uint64_t estimated_cycles(const batch_job_t *job) {
+  const uint64_t frame_cycles = job->max_frames != 0 && job->max_frames < UINT64_MAX / GB_CYCLES_PER_FRAME
+                              ? job->max_frames * GB_CYCLES_PER_FRAME
+                              : UINT64_MAX;
+  const uint64_t cycles = job->max_cycles != 0 ? job->max_cycles : UINT64_MAX;
+
+  return frame_cycles < cycles ? frame_cycles : cycles;
+}
+
+static int compare_jobs(const void *a, const void *b) {
+  // Longest jobs first, so short ones fill the gaps at the end of the batch
+  const batch_job_t *job_a = a;
+  const batch_job_t *job_b = b;
+  const uint64_t cycles_a = estimated_cycles(job_a);
+  const uint64_t cycles_b = estimated_cycles(job_b);
+  if (cycles_a != cycles_b) { return cycles_a > cycles_b ? -1 : 1; }
+
+  return job_a->line < job_b->line ? -1 : job_a->line > job_b->line;
+}
+
+static void write_json_string(FILE *file, const char *text, size_t length) {
+  // Bytes above 0x7F are written as the matching Latin-1 code points
+  fputc('"', file);
+  for (size_t i = 0; i < length; i++) {
+    const uint8_t c = (uint8_t)text[i];
+    if (c == '"' || c == '\\') {
+      fprintf(file, "\\%c", c);
+    } else if (c < 0x20 || c > 0x7E) {
+      fprintf(file, "\\u%04x", c);
+    } else {
+      fputc(c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+static void write_result(FILE *file, const batch_job_t *job, const run_result_t *result, bool succeeded) {
+  // 64-bit hashes are written as hex strings, JSON numbers can't hold them exactly
+  fprintf(file, "{\"id\":");
+  write_json_string(file, job->id, strlen(job->id));
+  fprintf(file, ",\"rom\":");
+  write_json_string(file, job->rom_path, strlen(job->rom_path));
+  fprintf(file, ",\"ok\":%s", succeeded ? "true" : "false");
+  fprintf(file, ",\"matched\":%s", result->matched ? "true" : "false");
+  fprintf(file, ",\"frames\":%llu", (unsigned long long)result->frames);
+  fprintf(file, ",\"cycles\":%llu", (unsigned long long)result->cycles);
+  fprintf(file, ",\"hash\":\"%016llx\"", (unsigned long long)result->hash);
+  fprintf(file, ",\"state_hash\":\"%016llx\"", (unsigned long long)result->state_hash);
+  fprintf(file, ",\"frame_hashes\":[");
+  for (size_t i = 0; i < result->frame_hash_count; i++) {
+    fprintf(file, "%s\"%016llx\"", i ? "," : "", (unsigned long long)result->frame_hashes[i]);
+  }
+  fprintf(file, "],\"serial\":");
+  write_json_string(file, result->serial ? result->serial : "", result->serial_size);
+  fprintf(file, ",\"seconds\":%.6f,\"cpu_seconds\":%.6f", result->seconds, result->cpu_seconds);
+  if (job->warmup_frames > 0) {
+    fprintf(file, ",\"warmup_cached\":%s,\"warmup_seconds\":%.6f", result->warmup_cached ? "true" : "false", result->warmup_seconds);
+  }
+  if (!succeeded) {
+    fprintf(file, ",\"error\":");
+    write_json_string(file, result->error, strlen(result->error));
+  }
+  fprintf(file, "}\n");
+}
+
+static void run_job(void *context, uint32_t index) {
+  batch_t *batch = context;
+  const batch_job_t *job = &batch->jobs[index];
+  const run_config_t config = {
+    .rom_path = job->rom_path,
+    .rom = job->rom,
+    .input_path = job->input_path,
+    .output_path = job->output_path,
+    .max_frames = job->max_frames,
+    .max_cycles = job->max_cycles,
+    .hash_interval = job->hash_interval,
+    .until = job->until,
+    .capture_serial = true,
+    .hash_state = true,
+    .rtc_source = batch->rtc_source,
+    .skip_boot = batch->skip_boot,
+    .warmup_frames = job->warmup_frames,
+    .state_cache = batch->state_cache_enabled ? &batch->state_cache : NULL,
+    .rom_sha1 = job->rom_sha1,
+  };
+
+  run_result_t result;
+  const bool succeeded = run_rom(&config, &result);
+
+  // Results are streamed, a partial file is still usable when the batch is interrupted
+  pthread_mutex_lock(&batch->results_mutex);
+  write_result(batch->results, job, &result, succeeded);
+  fflush(batch->results);
+  if (!succeeded) { batch->failed_count++; }
+  batch->cpu_seconds += result.cpu_seconds;
+  pthread_mutex_unlock(&batch->results_mutex);
+
+  run_result_free(&result);
+}
+
+bool run_batch(const batch_config_t *config) {
+  batch_t batch = { .rtc_source = config->rtc_source, .skip_boot = config->skip_boot };
+  bool succeeded = load_manifest(config->manifest_path, config, &batch);
+  if (succeeded && batch.count > UINT32_MAX) {
+    LOG_ERROR("too many jobs in %s.", config->manifest_path);
+    succeeded = false;
+  }
+  if (succeeded) {
+    batch.results = fopen(config->results_path, "w");
+    if (!batch.results) {
+      LOG_ERROR("failed to open results file %s.", config->results_path);
+      succeeded = false;
+    }
+  }
+
+  if (succeeded && config->state_cache_path) {
+    if (GB_FAILED(GB_state_cache_init(&batch.state_cache, config->state_cache_path, config->state_cache_size))) {
+      LOG_ERROR("failed to open state cache %s.", config->state_cache_path);
+      succeeded = false;
+    }
+    batch.state_cache_enabled = succeeded;
+  }
+
+  // Idle workers take the next job from a shared counter, so threads never wait on each other's queue
+  GB_thread_pool_t pool;
+  const uint32_t worker_count = config->thread_count ? config->thread_count - 1 : GB_thread_pool_default_size();
+  if (succeeded && GB_FAILED(GB_thread_pool_init(&pool, worker_count))) {
+    LOG_ERROR("failed to start %u worker threads.", worker_count);
+    succeeded = false;
+  }
+
+  if (succeeded) {
+    load_roms(&batch);
+    qsort(batch.jobs, batch.count, sizeof(batch_job_t), compare_jobs);
+    pthread_mutex_init(&batch.results_mutex, NULL);
+
+    const uint32_t thread_count = pool.thread_count + 1;
+    const double start_time = get_time_s();
+    GB_thread_pool_run(&pool, run_job, &batch, (uint32_t)batch.count);
+    const double seconds = get_time_s() - start_time;
+    GB_thread_pool_free(&pool);
+    pthread_mutex_destroy(&batch.results_mutex);
+
+    printf("jobs: %zu\n", batch.count);
+    printf("failed: %u\n", batch.failed_count);
+    printf("threads: %u\n", thread_count);
+    printf("time: %.3f s\n", seconds);
+    printf("cpu time: %.3f s\n", batch.cpu_seconds);
+    succeeded = batch.failed_count == 0;
+  }
+
+  if (batch.results && fclose(batch.results) != 0) {
+    LOG_ERROR("failed to write results file %s.", config->results_path);
+    succeeded = false;
+  }
+  for (size_t i = 0; i < batch.count; i++) { free_job(&batch.jobs[i]); }
+  free(batch.jobs);
+  if (batch.state_cache_enabled) { GB_state_cache_free(&batch.state_cache); }
+
+  return succeeded;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "runner.h"
+
+typedef struct {
+  const char *manifest_path;    // One JSON object per line: id, rom, input, output, until, frames, cycles, hash_interval, warmup
+  const char *results_path;     // One JSON object per finished job, in completion order
+  uint32_t thread_count;        // 0 runs one thread per core
+  uint64_t default_frames;      // Limits of jobs without frames or cycles
+  uint64_t default_cycles;
+  uint64_t hash_interval;       // Default for jobs without hash_interval
+  uint64_t warmup_frames;       // Default for jobs without warmup
+  GB_rtc_source_t rtc_source;
+  bool skip_boot;
+  const char *state_cache_path; // Directory of warm-up states shared by jobs and batches, NULL disables it
+  uint64_t state_cache_size;    // Bytes kept in it, 0 keeps everything
+} batch_config_t;
+
+// Returns false when the batch couldn't be run or any of its jobs failed
+bool run_batch(const batch_config_t *config);
@@ -0,0 +1,116 @@
+#include "bench.h"
+#include "log.h"
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_FRAMES_PER_STEP  (4)
+
+typedef struct {
+  double seconds;
+  GB_lanes_stats_t lanes;   // Instructions the lockstep run shared between lanes
+  uint64_t hash;            // Hash of all observations after the last step
+} bench_result_t;
+
+static double get_time_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t next_random(uint32_t *state) {
+  // xorshift32, the same seed gives both runs the same actions
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+
+  return x;
+}
+
+static bool run_envs(const bench_config_t *config, GB_rom_t *rom, bool lockstep, bench_result_t *result) {
+  const GB_vec_env_config_t env_config = {
+    .rom = rom,
+    .env_count = config->env_count,
+    .thread_count = config->thread_count ? config->thread_count - 1 : 0,
+    .observation = config->observation,
+    .lockstep = lockstep,
+    .skip_boot = config->skip_boot,
+  };
+  GB_vec_env_t vec;
+  if (GB_FAILED(GB_vec_env_init(&vec, &env_config))) {
+    LOG_ERROR("failed to create %u environments.", config->env_count);
+    return false;
+  }
+
+  uint8_t *actions = calloc(config->env_count, 1);
+  uint8_t *observations = malloc(config->env_count * vec.observation.size);
+  uint32_t *seeds = malloc(config->env_count * sizeof(uint32_t));
+  bool succeeded = actions && observations && seeds;
+  if (!succeeded) { LOG_ERROR("out of memory."); }
+
+  for (uint32_t i = 0; succeeded && i < config->env_count; i++) { seeds[i] = i + 1; }
+  memset(result, 0, sizeof(bench_result_t));
+  const uint64_t step_count = (config->frames + BENCH_FRAMES_PER_STEP - 1) / BENCH_FRAMES_PER_STEP;
+  const double start_time = get_time_s();
+  // Every environment presses its own random buttons, held for 15 steps, about a second
+  for (uint64_t step = 0; succeeded && step < step_count; step++) {
+    if (step % 15 == 0) {
+      for (uint32_t i = 0; i < config->env_count; i++) { actions[i] = (uint8_t)next_random(&seeds[i]); }
+    }
+    succeeded = GB_vec_env_step(&vec, actions, BENCH_FRAMES_PER_STEP, observations) == GB_SUCCESS;
+    if (!succeeded) { LOG_ERROR("step %llu failed.", (unsigned long long)step); }
+  }
+  result->seconds = get_time_s() - start_time;
+  result->lanes = vec.lanes_stats;
+  if (succeeded) {
+    result->hash = GB_hash_fnv1a64(GB_HASH_FNV1A64_INIT, observations, config->env_count * vec.observation.size);
+  }
+
+  free(seeds);
+  free(observations);
+  free(actions);
+  GB_vec_env_free(&vec);
+
+  return succeeded;
+}
+
+static void print_bench_result(const char *name, const bench_config_t *config, const bench_result_t *result) {
+  const double seconds = result->seconds > 0.0 ? result->seconds : 1e-9;
+  const uint64_t step_count = (config->frames + BENCH_FRAMES_PER_STEP - 1) / BENCH_FRAMES_PER_STEP;
+  const uint64_t frames = step_count * BENCH_FRAMES_PER_STEP * config->env_count;
+  const uint64_t instrs = result->lanes.instrs > 0 ? result->lanes.instrs : 1;
+  printf("%-9s %8.3f s %10.1f frames/s %6.1f%% vectorised  hash %016llx\n",
+         name,
+         result->seconds,
+         frames / seconds,
+         100.0 * result->lanes.vector_instrs / instrs,
+         (unsigned long long)result->hash);
+}
+
+bool run_vec_bench(const bench_config_t *config) {
+  GB_rom_t *rom = NULL;
+  if (GB_FAILED(GB_rom_load(&rom, config->rom_path))) {
+    LOG_ERROR("failed to load ROM %s.", config->rom_path);
+    return false;
+  }
+
+  bench_result_t scalar;
+  bench_result_t lockstep;
+  const bool succeeded = run_envs(config, rom, false, &scalar) && run_envs(config, rom, true, &lockstep);
+  GB_rom_release(rom);
+  if (!succeeded) { return false; }
+
+  printf("envs: %u, frames per env: %llu\n", config->env_count, (unsigned long long)config->frames);
+  print_bench_result("scalar", config, &scalar);
+  print_bench_result("lockstep", config, &lockstep);
+  printf("speedup: %.2fx\n", scalar.seconds / (lockstep.seconds > 0.0 ? lockstep.seconds : 1e-9));
+
+  // Both modes see the same actions, so they have to end on the same frames
+  if (scalar.hash != lockstep.hash) {
+    LOG_ERROR("lockstep observations differ from the scalar run.");
+    return false;
+  }
+
+  return true;
+}
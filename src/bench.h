@@ -0,0 +1,15 @@
+#pragma once
+
+#include "gbplay.h"
+
+typedef struct {
+  const char *rom_path;
+  uint32_t env_count;
+  uint32_t thread_count;    // 0 runs one thread per core
+  uint64_t frames;          // Frames per environment
+  bool skip_boot;
+  GB_observation_config_t observation;
+} bench_config_t;
+
+// Steps the environments with and without lockstep and prints the aggregate frame rates
+bool run_vec_bench(const bench_config_t *config);
@@ -0,0 +1,139 @@
+#include "battery.h"
+#include "gb.h"  // IWYU pragma: keep
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static size_t external_ram_size(GB_emulator_t *gb) {
+  return (size_t)gb->memory.external_ram_bank_count * 0x2000;
+}
+
+static bool has_rtc(GB_emulator_t *gb) {
+  return gb->memory.mbc.ops && gb->memory.mbc.ops->has_rtc;
+}
+
+static GB_result_t flush(GB_emulator_t *gb, int flags) {
+  // Pages are copied into the mapping, so forks and loaded states never write the file by themselves
+  for (uint8_t page = 0; page < gb->memory.external_ram_bank_count * 2; page++) {
+    memcpy(gb->battery.data + page * GB_MEMORY_PAGE_SIZE, gb->memory.page_data[GB_MEMORY_PAGE_EXTERNAL_RAM + page], GB_MEMORY_PAGE_SIZE);
+  }
+  if (has_rtc(gb)) { GB_rtc_save_trailer(gb, gb->battery.data + external_ram_size(gb)); }
+  if (msync(gb->battery.data, gb->battery.size, flags) != 0) { return GB_ERROR_IO; }
+
+  gb->memory.external_ram_dirty = false;
+  gb->battery.deferred_syncs = 0;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_battery_init(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  gb->battery.fd = -1;
+  gb->battery.data = NULL;
+  gb->battery.size = 0;
+  gb->battery.deferred_syncs = 0;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_battery_free(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+  if (gb->battery.fd < 0) { return GB_SUCCESS; }
+
+  // Last chance to persist the game save
+  const GB_result_t result = GB_battery_sync(gb, true);
+  munmap(gb->battery.data, gb->battery.size);
+  close(gb->battery.fd);
+  GB_battery_init(gb);
+
+  return result;
+}
+
+bool GB_battery_supported(GB_emulator_t *gb) {
+  if (!gb || !gb->memory.rom || (gb->memory.external_ram_bank_count == 0 && !has_rtc(gb))) { return false; }
+
+  switch (gb->memory.rom->header.cartridge_type) {
+    case 0x03:  // MBC1+RAM+BATTERY
+    case 0x06:  // MBC2+BATTERY
+    case 0x09:  // ROM+RAM+BATTERY
+    case 0x0D:  // MMM01+RAM+BATTERY
+    case 0x0F:  // MBC3+TIMER+BATTERY
+    case 0x10:  // MBC3+TIMER+RAM+BATTERY
+    case 0x13:  // MBC3+RAM+BATTERY
+    case 0x1B:  // MBC5+RAM+BATTERY
+    case 0x1E:  // MBC5+RUMBLE+RAM+BATTERY
+    case 0x22:  // MBC7+SENSOR+RUMBLE+RAM+BATTERY
+    case 0xFF:  // HuC1+RAM+BATTERY
+      return true;
+    default:
+      return false;
+  }
+}
+
+GB_result_t GB_battery_open(GB_emulator_t *gb, const char *path) {
+  if (!gb)                        { return GB_ERROR_INVALID_EMULATOR; }
+  if (!path)                      { return GB_ERROR_INVALID_ARGUMENT; }
+  if (!GB_battery_supported(gb))  { return GB_ERROR_INVALID_ARGUMENT; }
+
+  GB_TRY(GB_battery_free(gb));
+
+  const int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) { return GB_ERROR_IO; }
+
+  // New or short files are zero extended, longer ones keep their trailing data
+  const size_t ram_size = external_ram_size(gb);
+  const size_t size = ram_size + (has_rtc(gb) ? GB_RTC_SAV_TRAILER_SIZE : 0);
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      ((size_t)file_stat.st_size < size && ftruncate(fd, size) != 0)) {
+    close(fd);
+    return GB_ERROR_IO;
+  }
+
+  uint8_t *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    close(fd);
+    return GB_ERROR_IO;
+  }
+
+  // Saved RAM replaces the current contents
+  for (uint8_t page = 0; page < gb->memory.external_ram_bank_count * 2; page++) {
+    const GB_result_t result = GB_memory_unshare_page(gb, GB_MEMORY_PAGE_EXTERNAL_RAM + page, false);
+    if (GB_FAILED(result)) {
+      munmap(data, size);
+      close(fd);
+      return result;
+    }
+    memcpy(gb->memory.page_data[GB_MEMORY_PAGE_EXTERNAL_RAM + page], data + page * GB_MEMORY_PAGE_SIZE, GB_MEMORY_PAGE_SIZE);
+  }
+
+  // Clock continues from the trailer, the 44 byte variant has a 32-bit timestamp
+  if (has_rtc(gb) && (size_t)file_stat.st_size >= ram_size + GB_RTC_SAV_TRAILER_SIZE - 4) {
+    GB_rtc_load_trailer(gb, data + ram_size);
+  }
+
+  gb->battery.fd = fd;
+  gb->battery.data = data;
+  gb->battery.size = size;
+  gb->battery.deferred_syncs = 0;
+  gb->memory.external_ram_dirty = false;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_battery_sync(GB_emulator_t *gb, bool force) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+  if (gb->battery.fd < 0) { return GB_SUCCESS; }
+
+  // Clock keeps running without RAM writes, so it's always stored on the final flush
+  if (!gb->memory.external_ram_dirty && !(force && has_rtc(gb))) { return GB_SUCCESS; }
+
+  // Games disable RAM once a save is complete, so half-written saves are usually not flushed
+  if (!force && gb->memory.mbc.ram_enabled && ++gb->battery.deferred_syncs < GB_BATTERY_MAX_DEFERRED_SYNCS) {
+    return GB_SUCCESS;
+  }
+
+  return flush(gb, force ? MS_SYNC : MS_ASYNC);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "defs.h"
+
+#define GB_BATTERY_MAX_DEFERRED_SYNCS (10)  // Syncs skipped while the game keeps RAM enabled before it's flushed anyway
+
+typedef struct {
+  int fd;                     // Save file, -1 when cartridge RAM is not persisted
+  uint8_t *data;              // Shared mapping of the save file
+  size_t size;
+  uint32_t deferred_syncs;
+} GB_battery_t;
+
+GB_result_t GB_battery_init(GB_emulator_t *gb);
+GB_result_t GB_battery_free(GB_emulator_t *gb);
+bool GB_battery_supported(GB_emulator_t *gb);
+GB_result_t GB_battery_open(GB_emulator_t *gb, const char *path);
+GB_result_t GB_battery_sync(GB_emulator_t *gb, bool force);
@@ -0,0 +1,279 @@
+#include "checkpoint.h"
+#include "gb.h"  // IWYU pragma: keep
+#include "hash.h"
+#include "rle.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static bool reserve(uint8_t **buffer, size_t *capacity, size_t size) {
+  if (*capacity >= size) { return true; }
+
+  uint8_t *data = realloc(*buffer, size);
+  if (!data) { return false; }
+  *buffer = data;
+  *capacity = size;
+
+  return true;
+}
+
+static bool slot_path(char *out, const char *path, uint32_t slot, const char *suffix) {
+  const int length = snprintf(out, PATH_MAX, "%s.%u%s", path, slot, suffix);
+  return length > 0 && length < PATH_MAX;
+}
+
+static bool write_all(int fd, const uint8_t *data, size_t size) {
+  while (size > 0) {
+    const ssize_t written = write(fd, data, size);
+    if (written < 0) { return false; }
+    data += written;
+    size -= written;
+  }
+
+  return true;
+}
+
+static bool read_all(int fd, uint8_t *data, size_t size) {
+  while (size > 0) {
+    const ssize_t count = read(fd, data, size);
+    if (count <= 0) { return false; }
+    data += count;
+    size -= count;
+  }
+
+  return true;
+}
+
+static void sync_directory(const char *path) {
+  // Rename is durable only once the directory entry is flushed
+  char directory[PATH_MAX];
+  const char *separator = strrchr(path, '/');
+  if (!separator) {
+    strcpy(directory, ".");
+  } else if (separator == path) {
+    strcpy(directory, "/");
+  } else {
+    const size_t length = separator - path;
+    if (length >= PATH_MAX) { return; }
+    memcpy(directory, path, length);
+    directory[length] = '\0';
+  }
+
+  const int fd = open(directory, O_RDONLY);
+  if (fd < 0) { return; }
+  fsync(fd);
+  close(fd);
+}
+
+static bool write_checkpoint(GB_checkpoint_t *checkpoint, const GB_checkpoint_buffer_t *buffer) {
+  const size_t bound = sizeof(GB_checkpoint_header_t) + GB_rle_encoded_size_bound(buffer->size);
+  if (!reserve(&checkpoint->encoded, &checkpoint->encoded_capacity, bound)) { return false; }
+
+  uint8_t *encoded = checkpoint->encoded + sizeof(GB_checkpoint_header_t);
+  const size_t encoded_size = GB_rle_encode(encoded, buffer->data, NULL, buffer->size);
+  const GB_checkpoint_header_t header = {
+    .magic = GB_CHECKPOINT_MAGIC,
+    .version = GB_CHECKPOINT_VERSION,
+    .sequence = buffer->sequence,
+    .state_size = (uint32_t)buffer->size,
+    .encoded_size = (uint32_t)encoded_size,
+    .crc = GB_hash_crc32(0, encoded, encoded_size)
+  };
+  memcpy(checkpoint->encoded, &header, sizeof(GB_checkpoint_header_t));
+
+  // Written next to the target and renamed over it, so a crash leaves either the old or the new file
+  char temp_path[PATH_MAX], final_path[PATH_MAX];
+  const uint32_t slot = buffer->sequence % GB_CHECKPOINT_SLOTS;
+  if (!slot_path(temp_path, checkpoint->path, slot, ".tmp") ||
+      !slot_path(final_path, checkpoint->path, slot, "")) { return false; }
+
+  const int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) { return false; }
+  const bool synced = write_all(fd, checkpoint->encoded, sizeof(GB_checkpoint_header_t) + encoded_size) && fsync(fd) == 0;
+  if (close(fd) != 0 || !synced || rename(temp_path, final_path) != 0) {
+    unlink(temp_path);
+    return false;
+  }
+  sync_directory(final_path);
+
+  return true;
+}
+
+static bool read_checkpoint(const char *path, uint32_t slot, GB_checkpoint_header_t *header, uint8_t **encoded) {
+  char file_path[PATH_MAX];
+  if (!slot_path(file_path, path, slot, "")) { return false; }
+
+  const int fd = open(file_path, O_RDONLY);
+  if (fd < 0) { return false; }
+
+  // Truncated or corrupted files are ignored
+  struct stat file_stat;
+  bool valid = fstat(fd, &file_stat) == 0 &&
+               (size_t)file_stat.st_size >= sizeof(GB_checkpoint_header_t) &&
+               read_all(fd, (uint8_t *)header, sizeof(GB_checkpoint_header_t)) &&
+               header->magic == GB_CHECKPOINT_MAGIC &&
+               header->version == GB_CHECKPOINT_VERSION &&
+               header->sequence % GB_CHECKPOINT_SLOTS == slot &&
+               (size_t)file_stat.st_size == sizeof(GB_checkpoint_header_t) + header->encoded_size;
+  if (valid && encoded) {
+    *encoded = malloc(header->encoded_size ? header->encoded_size : 1);
+    valid = *encoded &&
+            read_all(fd, *encoded, header->encoded_size) &&
+            GB_hash_crc32(0, *encoded, header->encoded_size) == header->crc;
+    if (!valid) {
+      free(*encoded);
+      *encoded = NULL;
+    }
+  }
+  close(fd);
+
+  return valid;
+}
+
+static void *writer_main(void *arg) {
+  GB_checkpoint_t *checkpoint = arg;
+
+  pthread_mutex_lock(&checkpoint->mutex);
+  for (;;) {
+    while (!checkpoint->shutdown && !checkpoint->has_staged) {
+      pthread_cond_wait(&checkpoint->work_cond, &checkpoint->mutex);
+    }
+    if (!checkpoint->has_staged) { break; }
+
+    // Staged buffer is owned by the writer until the file is on disk
+    checkpoint->writing_buffer = checkpoint->staged_buffer;
+    checkpoint->writing = true;
+    checkpoint->has_staged = false;
+    pthread_mutex_unlock(&checkpoint->mutex);
+
+    const bool written = write_checkpoint(checkpoint, &checkpoint->buffers[checkpoint->writing_buffer]);
+
+    pthread_mutex_lock(&checkpoint->mutex);
+    checkpoint->writing = false;
+    if (written) {
+      checkpoint->written_count++;
+    } else {
+      checkpoint->failed_count++;
+    }
+  }
+  pthread_mutex_unlock(&checkpoint->mutex);
+
+  return NULL;
+}
+
+GB_result_t GB_checkpoint_init(GB_checkpoint_t *checkpoint, const GB_checkpoint_config_t *config) {
+  if (!checkpoint || !config || !config->path) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  memset(checkpoint, 0, sizeof(GB_checkpoint_t));
+  checkpoint->interval = config->interval > 0 ? config->interval : GB_CHECKPOINT_DEFAULT_INTERVAL;
+  checkpoint->path = strdup(config->path);
+  if (!checkpoint->path) { return GB_ERROR_OUT_OF_MEMORY; }
+
+  // Sequence continues after the checkpoints already on disk
+  for (uint32_t slot = 0; slot < GB_CHECKPOINT_SLOTS; slot++) {
+    GB_checkpoint_header_t header;
+    if (read_checkpoint(checkpoint->path, slot, &header, NULL) && header.sequence >= checkpoint->next_sequence) {
+      checkpoint->next_sequence = header.sequence + 1;
+    }
+  }
+
+  pthread_mutex_init(&checkpoint->mutex, NULL);
+  pthread_cond_init(&checkpoint->work_cond, NULL);
+  if (pthread_create(&checkpoint->writer, NULL, writer_main, checkpoint) != 0) {
+    pthread_cond_destroy(&checkpoint->work_cond);
+    pthread_mutex_destroy(&checkpoint->mutex);
+    free(checkpoint->path);
+    return GB_ERROR_OUT_OF_MEMORY;
+  }
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_checkpoint_free(GB_checkpoint_t *checkpoint) {
+  if (!checkpoint) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Writer drains the staged state before it exits
+  pthread_mutex_lock(&checkpoint->mutex);
+  checkpoint->shutdown = true;
+  pthread_cond_broadcast(&checkpoint->work_cond);
+  pthread_mutex_unlock(&checkpoint->mutex);
+  pthread_join(checkpoint->writer, NULL);
+
+  for (uint32_t i = 0; i < 2; i++) { free(checkpoint->buffers[i].data); }
+  free(checkpoint->encoded);
+  free(checkpoint->path);
+
+  pthread_cond_destroy(&checkpoint->work_cond);
+  pthread_mutex_destroy(&checkpoint->mutex);
+  memset(checkpoint, 0, sizeof(GB_checkpoint_t));
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_checkpoint_push(GB_checkpoint_t *checkpoint, GB_emulator_t *gb, bool force) {
+  if (!gb)         { return GB_ERROR_INVALID_EMULATOR; }
+  if (!checkpoint) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  if (!force && ++checkpoint->frames_since_checkpoint < checkpoint->interval) { return GB_SUCCESS; }
+  checkpoint->frames_since_checkpoint = 0;
+
+  // Buffer not owned by the writer is taken back, a state still waiting for it is replaced by the newer one
+  pthread_mutex_lock(&checkpoint->mutex);
+  const uint32_t target = checkpoint->writing ? 1 - checkpoint->writing_buffer :
+                          checkpoint->has_staged ? checkpoint->staged_buffer : 0;
+  checkpoint->has_staged = false;
+  pthread_mutex_unlock(&checkpoint->mutex);
+
+  // Only a state copy is made here, encoding and disk I/O happen on the writer thread
+  GB_checkpoint_buffer_t *buffer = &checkpoint->buffers[target];
+  if (!reserve(&buffer->data, &buffer->capacity, GB_emulator_state_size(gb))) { return GB_ERROR_OUT_OF_MEMORY; }
+  GB_TRY(GB_emulator_save_state(gb, buffer->data, buffer->capacity, &buffer->size));
+  buffer->sequence = checkpoint->next_sequence++;
+
+  pthread_mutex_lock(&checkpoint->mutex);
+  checkpoint->staged_buffer = target;
+  checkpoint->has_staged = true;
+  pthread_cond_signal(&checkpoint->work_cond);
+  pthread_mutex_unlock(&checkpoint->mutex);
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_checkpoint_resume(const char *path, GB_emulator_t *gb) {
+  if (!gb)   { return GB_ERROR_INVALID_EMULATOR; }
+  if (!path) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  GB_checkpoint_header_t headers[GB_CHECKPOINT_SLOTS];
+  uint8_t *encoded[GB_CHECKPOINT_SLOTS] = { NULL };
+  for (uint32_t slot = 0; slot < GB_CHECKPOINT_SLOTS; slot++) {
+    read_checkpoint(path, slot, &headers[slot], &encoded[slot]);
+  }
+
+  // Newest valid checkpoint wins, older ones are the fallback
+  GB_result_t result = GB_ERROR_CHECKPOINT_NOT_FOUND;
+  for (;;) {
+    int32_t newest = -1;
+    for (uint32_t slot = 0; slot < GB_CHECKPOINT_SLOTS; slot++) {
+      if (encoded[slot] && (newest < 0 || headers[slot].sequence > headers[newest].sequence)) { newest = (int32_t)slot; }
+    }
+    if (newest < 0) { break; }
+
+    const GB_checkpoint_header_t *header = &headers[newest];
+    uint8_t *state = malloc(header->state_size ? header->state_size : 1);
+    if (!state) {
+      result = GB_ERROR_OUT_OF_MEMORY;
+    } else if (!GB_rle_decode(encoded[newest], header->encoded_size, state, header->state_size, false)) {
+      result = GB_ERROR_INVALID_STATE;
+    } else {
+      result = GB_emulator_load_state(gb, state, header->state_size);
+    }
+    free(state);
+    free(encoded[newest]);
+    encoded[newest] = NULL;
+    if (result == GB_SUCCESS) { break; }
+  }
+  for (uint32_t slot = 0; slot < GB_CHECKPOINT_SLOTS; slot++) { free(encoded[slot]); }
+
+  return result;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "defs.h"
+#include <pthread.h>
+
+#define GB_CHECKPOINT_MAGIC             (0x4B434247)  // "GBCK"
+#define GB_CHECKPOINT_VERSION           (1)
+#define GB_CHECKPOINT_SLOTS             (2)           // Files written in turn, so a torn write never loses the last good one
+#define GB_CHECKPOINT_DEFAULT_INTERVAL  (3600)        // One checkpoint per minute of emulated time
+
+;
+#pragma pack(push, 1)
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint64_t sequence;        // Increases with every checkpoint, the highest valid one is resumed
+  uint32_t state_size;
+  uint32_t encoded_size;
+  uint32_t crc;             // CRC-32 of the encoded state
+} GB_checkpoint_header_t;   // Followed by the RLE encoded save state
+
+#pragma pack(pop)
+
+typedef struct {
+  const char *path;         // Checkpoints are stored as <path>.0 and <path>.1
+  uint32_t interval;        // Frames between checkpoints
+} GB_checkpoint_config_t;
+
+typedef struct {
+  uint8_t *data;
+  size_t capacity;
+  size_t size;
+  uint64_t sequence;
+} GB_checkpoint_buffer_t;
+
+typedef struct {
+  char *path;
+  uint32_t interval;
+  uint32_t frames_since_checkpoint;
+  uint64_t next_sequence;
+
+  // Double buffer, the emulation thread fills one while the writer owns the other
+  GB_checkpoint_buffer_t buffers[2];
+  uint32_t staged_buffer;
+  bool has_staged;
+  uint32_t writing_buffer;
+  bool writing;
+  uint8_t *encoded;         // Writer output, only touched by the writer thread
+  size_t encoded_capacity;
+
+  uint64_t written_count;
+  uint64_t failed_count;
+
+  pthread_t writer;
+  pthread_mutex_t mutex;
+  pthread_cond_t work_cond;     // Signaled when a state is staged or on shutdown
+  bool shutdown;
+} GB_checkpoint_t;
+
+GB_result_t GB_checkpoint_init(GB_checkpoint_t *checkpoint, const GB_checkpoint_config_t *config);
+GB_result_t GB_checkpoint_free(GB_checkpoint_t *checkpoint);
+GB_result_t GB_checkpoint_push(GB_checkpoint_t *checkpoint, GB_emulator_t *gb, bool force);
+GB_result_t GB_checkpoint_resume(const char *path, GB_emulator_t *gb);
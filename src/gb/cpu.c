@@ -1,5 +1,6 @@
 #include "cpu.h"
 #include "gb.h"  // IWYU pragma: keep
+#include <pthread.h>
 
 #define INSTR_BEGIN(name) \
   static GB_result_t name(GB_emulator_t *gb) { \
@@ -29,11 +30,29 @@
 
 static GB_cpu_instr_t main_instr_set[256];
 static GB_cpu_instr_t cb_instr_set[256];
+static pthread_once_t instr_sets_once = PTHREAD_ONCE_INIT;
+
+static GB_result_t write_page(GB_emulator_t *gb, uint8_t first_page, uint16_t offset) {
+  // Pages shared with a fork are copied on the first write
+  const uint8_t page = first_page + (offset >> GB_MEMORY_PAGE_SHIFT);
+  const uint64_t page_bit = 1ull << page;
+  if (gb->memory.shared_pages & page_bit) { GB_TRY(GB_memory_unshare_page(gb, page, true)); }
+  gb->memory.dirty_pages |= page_bit;
+  gb->memory.page_data[page][offset & (GB_MEMORY_PAGE_SIZE - 1)] = gb->cpu.write_value;
+
+  return GB_SUCCESS;
+}
 
 static GB_result_t memory_read(GB_emulator_t *gb) {
   // Real memory return 0xFF or 0x00 if not accessible
   gb->cpu.read_value = 0xFF;
 
+  // Handle OAM DMA bus conflicts
+  if (gb->dma.active && GB_dma_blocks(gb, gb->cpu.addr)) {
+    gb->cpu.read_value = GB_dma_bus_value(gb, gb->cpu.addr);
+    return GB_SUCCESS;
+  }
+
   // Handle Boot ROM
   if (gb->cpu.addr < 0x0100 &&
       gb->memory.io &&
@@ -51,9 +70,8 @@ static GB_result_t memory_read(GB_emulator_t *gb) {
 
   // Handle ROM switchable banks
   if (gb->cpu.addr < 0x8000) {
-    if (gb->memory.mbc.rom_bank == 0 ||
-        !gb->memory.rom_x[gb->memory.mbc.rom_bank - 1]) { GB_ERROR(gb, GB_ERROR_INVALID_MEMORY_ACCESS, "Invalid access to ROM %d", gb->memory.mbc.rom_bank); return GB_ERROR_INVALID_MEMORY_ACCESS; }
-    gb->cpu.read_value = gb->memory.rom_x[gb->memory.mbc.rom_bank - 1][gb->cpu.addr - 0x4000];
+    if (!gb->memory.mbc.rom_x) { GB_ERROR(gb, GB_ERROR_INVALID_MEMORY_ACCESS, "Invalid access to ROM %d", gb->memory.mbc.rom_bank); return GB_ERROR_INVALID_MEMORY_ACCESS; }
+    gb->cpu.read_value = gb->memory.mbc.rom_x[gb->cpu.addr - 0x4000];
     return GB_SUCCESS;
   }
 
@@ -61,28 +79,31 @@ static GB_result_t memory_read(GB_emulator_t *gb) {
   if (gb->cpu.addr < 0xA000) {
     const uint8_t mode = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_STAT)] & 0x03;
     if (mode != GB_PPU_MODE_DRAWING) {
-      gb->cpu.read_value = gb->memory.vram[GB_MEMORY_VRAM_OFFSET(gb->cpu.addr)];
+      gb->cpu.read_value = GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(gb->cpu.addr));
     }
     return GB_SUCCESS;
   }
 
-  // Handle external RAM
+  // Handle external RAM, disabled or missing RAM reads as 0xFF
   if (gb->cpu.addr < 0xC000) {
-    if (!gb->memory.mbc.ram_enabled ||
-        !gb->memory.external_ram[gb->memory.mbc.ram_bank]) { GB_ERROR(gb, GB_ERROR_INVALID_MEMORY_ACCESS, "Invalid access to external RAM"); return GB_ERROR_INVALID_MEMORY_ACCESS; }
-    gb->cpu.read_value = gb->memory.external_ram[gb->memory.mbc.ram_bank][gb->cpu.addr - 0xA000];
+    const GB_mbc_t *mbc = &gb->memory.mbc;
+    if (mbc->ram_page == GB_MBC_RAM_RTC) {
+      gb->cpu.read_value = mbc->rtc.latched[mbc->ram_bank - 0x08];
+    } else if (mbc->ram_page != GB_MBC_RAM_UNMAPPED) {
+      gb->cpu.read_value = GB_MEMORY_PAGED(&gb->memory, mbc->ram_page, (gb->cpu.addr - 0xA000) & mbc->ram_address_mask) | mbc->ram_value_mask;
+    }
     return GB_SUCCESS;
   }
 
   // Handle WRAM
   if (gb->cpu.addr < 0xE000) {
-    gb->cpu.read_value = gb->memory.wram[GB_MEMORY_WRAM_OFFSET(gb->cpu.addr)];
+    gb->cpu.read_value = GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_WRAM, GB_MEMORY_WRAM_OFFSET(gb->cpu.addr));
     return GB_SUCCESS;
   }
 
   // Handle echo RAM (in this case mirror of WRAM)
   if (gb->cpu.addr < 0xFE00) {
-    gb->cpu.read_value = gb->memory.echo_ram[GB_MEMORY_ECHO_OFFSET(gb->cpu.addr)];
+    gb->cpu.read_value = GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_WRAM, GB_MEMORY_ECHO_OFFSET(gb->cpu.addr));
     return GB_SUCCESS;
   }
 
@@ -105,6 +126,8 @@ static GB_result_t memory_read(GB_emulator_t *gb) {
   if (gb->cpu.addr < 0xFF80) {
     switch (gb->cpu.addr) {
       case GB_HARDWARE_REGISTER_P1JOYP:
+        gb->cpu.read_value = GB_joypad_read(gb);
+        break;
       case GB_HARDWARE_REGISTER_SB:
       case GB_HARDWARE_REGISTER_SC:
       case GB_HARDWARE_REGISTER_DIV:
@@ -162,7 +185,7 @@ static GB_result_t memory_read(GB_emulator_t *gb) {
 
   // Handle interrupt enable register
   if (gb->cpu.addr == 0xFFFF) {
-    gb->cpu.read_value = gb->memory.ie;
+    gb->cpu.read_value = *gb->memory.ie;
     return GB_SUCCESS;
   }
 
@@ -171,65 +194,54 @@ static GB_result_t memory_read(GB_emulator_t *gb) {
 }
 
 static GB_result_t memory_write(GB_emulator_t *gb) {
-  if (gb->cpu.addr < 0x8000) {
-    if (gb->cpu.addr < 0x2000) {
-      // RAM enable/disable
-      gb->memory.mbc.ram_enabled = (gb->cpu.write_value & 0x0F) == 0x0A;
-    } else if (gb->cpu.addr < 0x4000) {
-      // ROM bank lower 5 bits
-      uint8_t bank = gb->cpu.write_value & 0x1F;
-      if (bank == 0) { bank = 1; }  // Bank 0 cannot be selected
-      gb->memory.mbc.rom_bank = (gb->memory.mbc.rom_bank & 0x60) | bank;
-    } else if (gb->cpu.addr < 0x6000) {
-      // RAM bank number or upper ROM bank bits
-      if (gb->memory.mbc.mode == 0) {
-        // Upper bits of ROM bank (MBC1)
-        gb->memory.mbc.rom_bank = (gb->memory.mbc.rom_bank & 0x1F) | ((gb->cpu.write_value & 0x03) << 5);
-      } else {
-        // RAM bank number
-        gb->memory.mbc.ram_bank = gb->cpu.write_value & 0x03;
-      }
-    } else if (gb->cpu.addr < 0x8000) {
-      // Mode select
-      gb->memory.mbc.mode = gb->cpu.write_value & 0x01;
-      if (gb->memory.mbc.mode == 1) {
-        gb->memory.mbc.rom_bank &= 0x1F;
-      }
-    }
+  // Writes to a watched block are flagged without a branch, the bitmap is empty unless a predicate runs
+  gb->cpu.watch_hit |= (gb->cpu.watched_blocks[gb->cpu.addr >> 14] >> ((gb->cpu.addr >> 8) & 63)) & 1;
+
+  // Handle OAM DMA bus conflicts, writes to the bus used by the transfer are lost
+  if (gb->dma.active && GB_dma_blocks(gb, gb->cpu.addr)) {
     return GB_SUCCESS;
   }
 
+  // Handle MBC registers
+  if (gb->cpu.addr < 0x8000) {
+    return GB_mbc_write(gb, gb->cpu.addr, gb->cpu.write_value);
+  }
+
   // Handle VRAM
   if (gb->cpu.addr < 0xA000) {
     const uint8_t mode = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_STAT)] & 0x03;
     if (mode != GB_PPU_MODE_DRAWING) {
-      gb->memory.vram[GB_MEMORY_VRAM_OFFSET(gb->cpu.addr)] = gb->cpu.write_value;
+      if (gb->ppu.pending_line_count > 0) { GB_TRY(GB_ppu_flush(gb)); }
+      GB_TRY(write_page(gb, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(gb->cpu.addr)));
     }
     return GB_SUCCESS;
   }
 
-  // Handle external RAM
+  // Handle external RAM, writes to disabled or missing RAM are ignored
   if (gb->cpu.addr < 0xC000) {
-    if (gb->memory.mbc.ram_enabled) {
-      const uint8_t ram_bank = gb->memory.mbc.mode == 1 ? gb->memory.mbc.ram_bank : 0;
-      if (ram_bank >= 16 || !gb->memory.external_ram[ram_bank]) { GB_ERROR(gb, GB_ERROR_INVALID_MEMORY_ACCESS, "Invalid external RAM bank"); return GB_ERROR_INVALID_MEMORY_ACCESS; }
-
-      uint8_t *ram_ptr = gb->memory.external_ram[ram_bank];
-      if (!ram_ptr) { return GB_ERROR_INVALID_MEMORY_ACCESS; }
-      ram_ptr[gb->cpu.addr - 0xA000] = gb->cpu.write_value;
+    const GB_mbc_t *mbc = &gb->memory.mbc;
+    if (mbc->ram_page == GB_MBC_RAM_RTC) {
+      return GB_mbc_write(gb, gb->cpu.addr, gb->cpu.write_value);
+    } else if (mbc->ram_page != GB_MBC_RAM_UNMAPPED) {
+      // Only real changes are persisted to the battery save
+      const uint16_t offset = (gb->cpu.addr - 0xA000) & mbc->ram_address_mask;
+      if (GB_MEMORY_PAGED(&gb->memory, mbc->ram_page, offset) != gb->cpu.write_value) {
+        gb->memory.external_ram_dirty = true;
+        GB_TRY(write_page(gb, mbc->ram_page, offset));
+      }
     }
     return GB_SUCCESS;
   }
 
   // Handle WRAM
   if (gb->cpu.addr < 0xE000) {
-    gb->memory.wram[GB_MEMORY_WRAM_OFFSET(gb->cpu.addr)] = gb->cpu.write_value;
+    GB_TRY(write_page(gb, GB_MEMORY_PAGE_WRAM, GB_MEMORY_WRAM_OFFSET(gb->cpu.addr)));
     return GB_SUCCESS;
   }
 
   // Handle echo RAM (in this case mirror of WRAM)
   if (gb->cpu.addr < 0xFE00) {
-    gb->memory.echo_ram[GB_MEMORY_ECHO_OFFSET(gb->cpu.addr)] = gb->cpu.write_value;
+    GB_TRY(write_page(gb, GB_MEMORY_PAGE_WRAM, GB_MEMORY_ECHO_OFFSET(gb->cpu.addr)));
     return GB_SUCCESS;
   }
 
@@ -237,6 +249,7 @@ static GB_result_t memory_write(GB_emulator_t *gb) {
   if (gb->cpu.addr < 0xFEA0) {
     const uint8_t mode = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_STAT)] & 0x03;
     if (mode == GB_PPU_MODE_HBLANK || mode == GB_PPU_MODE_VBLANK) {
+      if (gb->ppu.pending_line_count > 0) { GB_TRY(GB_ppu_flush(gb)); }
       gb->memory.oam[GB_MEMORY_OAM_OFFSET(gb->cpu.addr)] = gb->cpu.write_value;
     }
     return GB_SUCCESS;
@@ -255,24 +268,16 @@ static GB_result_t memory_write(GB_emulator_t *gb) {
 //      GB_timer_glitch(gb, old_div_counter);
       return GB_SUCCESS;
     } else if (gb->cpu.addr == GB_HARDWARE_REGISTER_SC) {
-      if (gb->cpu.write_value & 0x80) {
-        gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_IF)] &= ~(1 << 3);
-      }
+      GB_TRY(GB_serial_write_control(gb, gb->cpu.write_value));
     } else if (gb->cpu.addr == GB_HARDWARE_REGISTER_BOOT) {
-      gb->memory.ie = 0x01;
+      *gb->memory.ie = 0x01;
       gb->cpu.reg.ime = 1;
     } else if (gb->cpu.addr == GB_HARDWARE_REGISTER_DMA) {
-      const uint16_t src = gb->cpu.write_value << 8;
-      const uint16_t addr = gb->cpu.addr;
-      for (uint16_t i = 0; i < 0xA0; i++) {
-        gb->cpu.addr = src + i;
-        GB_TRY(memory_read(gb));
-        gb->memory.oam[i] = gb->cpu.read_value;
-      }
-      gb->cpu.addr = addr;
+      GB_TRY(GB_dma_start(gb, gb->cpu.write_value));
     } else if (gb->cpu.addr == GB_HARDWARE_REGISTER_LCDC) {
       uint8_t stat = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_STAT)];
       if (!(gb->cpu.write_value & GB_PPU_LCDC_ENABLE)) {
+        GB_TRY(GB_ppu_flush(gb));
         gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_LY)] = 0;
         gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_STAT)] = (stat & ~0x03) | 0x00;
       }
@@ -289,7 +294,7 @@ static GB_result_t memory_write(GB_emulator_t *gb) {
 
   // Handle interrupt enable register
   if (gb->cpu.addr == 0xFFFF) {
-    gb->memory.ie = gb->cpu.write_value;
+    *gb->memory.ie = gb->cpu.write_value;
     return GB_SUCCESS;
   }
 
@@ -1970,11 +1975,7 @@ INSTR_END
 MAIN_INSTR_SET(INSTR_DEFINE);
 CB_INSTR_SET(INSTR_DEFINE);
 
-GB_result_t GB_cpu_init(GB_emulator_t *gb) {
-  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
-
-  memset(&gb->cpu, 0, sizeof(GB_cpu_t));
-
+static void register_instr_sets(void) {
 #define GEN(code, name, body) INSTR_REGISTER(main_instr_set, code, name)
   MAIN_INSTR_SET(GEN)
 #undef GEN
@@ -1982,6 +1983,15 @@ GB_result_t GB_cpu_init(GB_emulator_t *gb) {
 #define GEN(code, name, body) INSTR_REGISTER(cb_instr_set, code, name)
   CB_INSTR_SET(GEN)
 #undef GEN
+}
+
+GB_result_t GB_cpu_init(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  memset(&gb->cpu, 0, sizeof(GB_cpu_t));
+
+  // Tables are shared by all emulators, which may be initialized from several threads
+  pthread_once(&instr_sets_once, register_instr_sets);
 
   gb->cpu.phase = 0;
   gb->cpu.instr = fetch;
@@ -1995,6 +2005,65 @@ GB_result_t GB_cpu_free(GB_emulator_t *gb) {
   return GB_SUCCESS;
 }
 
+GB_result_t GB_cpu_get_instr_id(GB_emulator_t *gb, uint16_t *id) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+  if (!id) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Instruction is a function pointer, so it's mapped to a stable ID for serialization
+  if (gb->cpu.instr == fetch)            { *id = GB_CPU_INSTR_ID_FETCH;            return GB_SUCCESS; }
+  if (gb->cpu.instr == handle_interrupt) { *id = GB_CPU_INSTR_ID_HANDLE_INTERRUPT; return GB_SUCCESS; }
+  for (uint16_t code = 0; code < 256; code++) {
+    if (gb->cpu.instr == main_instr_set[code]) { *id = GB_CPU_INSTR_ID_MAIN + code; return GB_SUCCESS; }
+    if (gb->cpu.instr == cb_instr_set[code])   { *id = GB_CPU_INSTR_ID_CB + code;   return GB_SUCCESS; }
+  }
+
+  return GB_ERROR_INVALID_ARGUMENT;
+}
+
+static GB_cpu_instr_t instr_from_id(uint16_t id) {
+  if (id == GB_CPU_INSTR_ID_FETCH)            { return fetch; }
+  if (id == GB_CPU_INSTR_ID_HANDLE_INTERRUPT) { return handle_interrupt; }
+  if (id >= GB_CPU_INSTR_ID_MAIN && id < GB_CPU_INSTR_ID_MAIN + 256) { return main_instr_set[id - GB_CPU_INSTR_ID_MAIN]; }
+  if (id >= GB_CPU_INSTR_ID_CB && id < GB_CPU_INSTR_ID_CB + 256)     { return cb_instr_set[id - GB_CPU_INSTR_ID_CB]; }
+
+  return NULL;
+}
+
+bool GB_cpu_is_valid_instr_id(uint16_t id) {
+  return instr_from_id(id) != NULL;
+}
+
+GB_result_t GB_cpu_set_instr_id(GB_emulator_t *gb, uint16_t id) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  const GB_cpu_instr_t instr = instr_from_id(id);
+  if (!instr) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  gb->cpu.instr = instr;
+
+  return GB_SUCCESS;
+}
+
+bool GB_cpu_at_instruction_boundary(GB_emulator_t *gb) {
+  // Instructions end by scheduling the next fetch or interrupt at phase 0
+  return gb->cpu.phase == 0 && (gb->cpu.instr == fetch || gb->cpu.instr == handle_interrupt);
+}
+
+bool GB_cpu_decoded_opcode(GB_emulator_t *gb, uint8_t *opcode) {
+  // Last T-cycle of a fetch dispatches the opcode read the cycle before
+  if (gb->cpu.halted || gb->cpu.instr != fetch || gb->cpu.phase != 3) { return false; }
+  *opcode = gb->cpu.read_value;
+
+  return true;
+}
+
+GB_result_t GB_cpu_finish_instr(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  // Same end as the 4 cycle register instructions, which finish at their dispatch
+  return check_interrupts(gb);
+}
+
 GB_result_t GB_cpu_tick(GB_emulator_t *gb) {
   if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
 
@@ -2,6 +2,11 @@
 
 #include "defs.h"
 
+#define GB_CPU_INSTR_ID_FETCH             (0x0000)
+#define GB_CPU_INSTR_ID_HANDLE_INTERRUPT  (0x0001)
+#define GB_CPU_INSTR_ID_MAIN              (0x0100)  // + opcode
+#define GB_CPU_INSTR_ID_CB                (0x0200)  // + CB-prefixed opcode
+
 typedef GB_result_t (*GB_cpu_instr_t)(GB_emulator_t *gb);
 
 ;
@@ -67,9 +72,22 @@ typedef struct {
   uint8_t ime_pending_delay;
   bool halted;
   bool stopped;
+  uint64_t watched_blocks[4];  // 256-byte blocks whose writes set watch_hit, see GB_predicate_run_frame
+  bool watch_hit;
+  bool watch_matched;          // Last predicate run stopped on a match at watch_match_cycles
+  uint64_t watch_match_cycles;
 } GB_cpu_t;
 
 GB_result_t GB_cpu_init(GB_emulator_t *gb);
 GB_result_t GB_cpu_free(GB_emulator_t *gb);
 GB_result_t GB_cpu_tick(GB_emulator_t *gb);
+GB_result_t GB_cpu_get_instr_id(GB_emulator_t *gb, uint16_t *id);
+GB_result_t GB_cpu_set_instr_id(GB_emulator_t *gb, uint16_t id);
+bool GB_cpu_is_valid_instr_id(uint16_t id);
+bool GB_cpu_at_instruction_boundary(GB_emulator_t *gb);
+
+// True at the T-cycle an opcode is dispatched. A caller that executes the instruction itself,
+// only 4 cycle register instructions can be, ends it with GB_cpu_finish_instr instead of GB_cpu_tick
+bool GB_cpu_decoded_opcode(GB_emulator_t *gb, uint8_t *opcode);
+GB_result_t GB_cpu_finish_instr(GB_emulator_t *gb);
 
@@ -17,6 +17,8 @@
 #define GB_ERROR_MESSAGE_MAX_LENGTH   (256)
 
 #define GB_CYCLES_PER_FRAME           (70224)   // T-cycles of one full GB frame
+#define GB_CYCLES_PER_SECOND          (4194304) // T-cycles of one second
+#define GB_CYCLES_BOOT                (23440356) // T-cycles the DMG boot ROM runs before jumping to $0100
 
 #define GB_SCREEN_WIDTH               (160)
 #define GB_SCREEN_HEIGHT              (144)
@@ -115,6 +117,19 @@ typedef enum {
   /* CPU errors */
   GB_ERROR_ILLEGAL_OPCODE,
 
+  /* Save state errors */
+  GB_ERROR_BUFFER_TOO_SMALL,
+  GB_ERROR_INVALID_STATE,
+
+  /* Rewind errors */
+  GB_ERROR_REWIND_EMPTY,
+
+  /* Checkpoint errors */
+  GB_ERROR_CHECKPOINT_NOT_FOUND,
+
+  /* State cache errors */
+  GB_ERROR_STATE_CACHE_MISS,
+
   GB_RESULT_MAX
 } GB_result_t;
 
@@ -136,3 +151,6 @@ typedef struct {
 struct GB_emulator;
 typedef struct GB_emulator GB_emulator_t;
 
+struct GB_rom;
+typedef struct GB_rom GB_rom_t;
+
@@ -0,0 +1,142 @@
+#include "dma.h"
+#include "gb.h"  // IWYU pragma: keep
+
+static uint16_t source_address(GB_emulator_t *gb) {
+  // Sources above WRAM read the echo of its second half
+  const uint16_t addr = gb->dma.source_high << 8;
+  return addr >= 0xE000 ? addr - 0x2000 : addr;
+}
+
+static bool vram_bus(uint16_t addr) {
+  return addr >= 0x8000 && addr < 0xA000;
+}
+
+static void resolve_source(GB_emulator_t *gb) {
+  // Writes on the source bus are blocked until the transfer ends, so the region can't be remapped under it
+  GB_dma_t *dma = &gb->dma;
+  const GB_mbc_t *mbc = &gb->memory.mbc;
+  const uint16_t addr = source_address(gb);
+  dma->source = NULL;
+  dma->source_mask = 0xFF;  // Missing ROM and unmapped RAM read as 0xFF
+  if (addr < 0x4000) {
+    if (gb->memory.rom_0) { dma->source = gb->memory.rom_0 + addr; dma->source_mask = 0x00; }
+  } else if (addr < 0x8000) {
+    if (mbc->rom_x) { dma->source = mbc->rom_x + (addr - 0x4000); dma->source_mask = 0x00; }
+  } else if (addr < 0xA000) {
+    dma->source = &GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(addr));
+    dma->source_mask = 0x00;
+  } else if (addr < 0xC000) {
+    if (mbc->ram_page == GB_MBC_RAM_RTC) {
+      dma->source_mask = mbc->rtc.latched[mbc->ram_bank - 0x08];
+    } else if (mbc->ram_page != GB_MBC_RAM_UNMAPPED) {
+      // Masked RAM is smaller than a page and transfers start on a 256 byte boundary, so they never wrap
+      dma->source = &GB_MEMORY_PAGED(&gb->memory, mbc->ram_page, (addr - 0xA000) & mbc->ram_address_mask);
+      dma->source_mask = mbc->ram_value_mask;
+    }
+  } else {
+    dma->source = &GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_WRAM, GB_MEMORY_WRAM_OFFSET(addr));
+    dma->source_mask = 0x00;
+  }
+}
+
+static uint8_t source_byte(GB_emulator_t *gb, uint8_t index) {
+  const GB_dma_t *dma = &gb->dma;
+  return dma->source ? dma->source[index] | dma->source_mask : dma->source_mask;
+}
+
+static uint8_t progress(GB_emulator_t *gb) {
+  // Bytes the transfer has reached at the current cycle
+  const uint64_t cycles = gb->timer.cycles;
+  if (cycles < gb->dma.start_cycles) { return 0; }
+  const uint64_t count = (cycles - gb->dma.start_cycles) / GB_DMA_BYTE_CYCLES;
+
+  return count < GB_DMA_LENGTH ? (uint8_t)count : GB_DMA_LENGTH;
+}
+
+static GB_result_t reset(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  memset(&gb->dma, 0, sizeof(GB_dma_t));
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_dma_init(GB_emulator_t *gb) {
+  return reset(gb);
+}
+
+GB_result_t GB_dma_free(GB_emulator_t *gb) {
+  return reset(gb);
+}
+
+GB_result_t GB_dma_tick(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  // Nothing observed the transfer, it's completed with a single copy
+  if (!gb->dma.active || progress(gb) < GB_DMA_LENGTH) { return GB_SUCCESS; }
+
+  return GB_dma_sync(gb);
+}
+
+GB_result_t GB_dma_start(GB_emulator_t *gb, uint8_t source_high) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  // Restart keeps the bytes the previous transfer already wrote
+  if (gb->dma.active) { GB_TRY(GB_dma_sync(gb)); }
+
+  gb->dma.active = true;
+  gb->dma.source_high = source_high;
+  gb->dma.copied = 0;
+  gb->dma.start_cycles = gb->timer.cycles + GB_DMA_START_DELAY;
+  resolve_source(gb);
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_dma_sync(GB_emulator_t *gb) {
+  if (!gb)              { return GB_ERROR_INVALID_EMULATOR; }
+  if (!gb->memory.oam)  { return GB_ERROR_INVALID_ARGUMENT; }
+  if (!gb->dma.active)  { return GB_SUCCESS; }
+
+  const uint8_t count = progress(gb);
+  if (count <= gb->dma.copied) { return GB_SUCCESS; }
+
+  // Latched lines are rendered with the sprites they were latched with
+  if (gb->ppu.pending_line_count > 0) { GB_TRY(GB_ppu_flush(gb)); }
+
+  GB_dma_t *dma = &gb->dma;
+  if (dma->source && dma->source_mask == 0) {
+    memcpy(gb->memory.oam + dma->copied, dma->source + dma->copied, count - dma->copied);
+  } else {
+    for (uint8_t i = dma->copied; i < count; i++) { gb->memory.oam[i] = source_byte(gb, i); }
+  }
+  dma->copied = count;
+  dma->active = count < GB_DMA_LENGTH;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_dma_remap(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  // Resolved pointer follows memory pages replaced by a fork or a state load
+  if (gb->dma.active) { resolve_source(gb); }
+
+  return GB_SUCCESS;
+}
+
+bool GB_dma_blocks(GB_emulator_t *gb, uint16_t addr) {
+  // CPU keeps HRAM and I/O, OAM and the bus of the source belong to the transfer
+  if (!gb->dma.active || addr >= 0xFF00 || gb->timer.cycles < gb->dma.start_cycles) { return false; }
+  if (addr >= 0xFE00) { return true; }
+
+  return vram_bus(addr) == vram_bus(source_address(gb));
+}
+
+uint8_t GB_dma_bus_value(GB_emulator_t *gb, uint16_t addr) {
+  // Conflicting reads see the byte being transferred, OAM reads as 0xFF
+  if (addr >= 0xFE00) { return 0xFF; }
+  const uint8_t index = progress(gb);
+
+  return source_byte(gb, index < GB_DMA_LENGTH ? index : GB_DMA_LENGTH - 1);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "defs.h"
+
+#define GB_DMA_LENGTH         (0xA0)  // Bytes copied to OAM, one per M-cycle
+#define GB_DMA_START_DELAY    (4)     // T-cycles between the write to DMA and the first transferred byte
+#define GB_DMA_BYTE_CYCLES    (4)
+
+typedef struct {
+  // Transfer is scheduled, OAM is only brought up to date when it's observed or the transfer ends
+  bool active;
+  uint8_t source_high;     // Value written to DMA, the source address is source_high << 8
+  const uint8_t *source;   // Source region resolved at the start, NULL when the bus reads a constant
+  uint8_t source_mask;     // ORed into every source byte, the whole value when source is NULL
+  uint8_t copied;          // Bytes already written to OAM
+  uint64_t start_cycles;   // Timer cycle counter at which the first byte is transferred
+} GB_dma_t;
+
+GB_result_t GB_dma_init(GB_emulator_t *gb);
+GB_result_t GB_dma_free(GB_emulator_t *gb);
+GB_result_t GB_dma_tick(GB_emulator_t *gb);
+GB_result_t GB_dma_start(GB_emulator_t *gb, uint8_t source_high);
+GB_result_t GB_dma_sync(GB_emulator_t *gb);
+GB_result_t GB_dma_remap(GB_emulator_t *gb);
+bool GB_dma_blocks(GB_emulator_t *gb, uint16_t addr);
+uint8_t GB_dma_bus_value(GB_emulator_t *gb, uint16_t addr);
@@ -4,10 +4,15 @@
 GB_result_t GB_emulator_init(GB_emulator_t *gb) {
   if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
 
+  memset(&gb->last_error, 0, sizeof(GB_error_t));
   GB_TRY(GB_memory_init(gb));
   GB_TRY(GB_cpu_init(gb));
   GB_TRY(GB_ppu_init(gb));
   GB_TRY(GB_timer_init(gb));
+  GB_TRY(GB_dma_init(gb));
+  GB_TRY(GB_serial_init(gb));
+  GB_TRY(GB_joypad_init(gb));
+  GB_TRY(GB_battery_init(gb));
 
 //  // Test CPU
 //  gb->memory.rom_0 = malloc(0x2000);
@@ -79,6 +84,10 @@ GB_result_t GB_emulator_free(GB_emulator_t *gb) {
   if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
 
   // Currently don't care about result status code of each free method
+  GB_battery_free(gb);
+  GB_joypad_free(gb);
+  GB_serial_free(gb);
+  GB_dma_free(gb);
   GB_timer_free(gb);
   GB_ppu_free(gb);
   GB_cpu_free(gb);
@@ -91,123 +100,156 @@ GB_result_t GB_emulator_tick(GB_emulator_t *gb) {
   if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
 
   GB_TRY(GB_cpu_tick(gb));
+
+  return GB_emulator_tick_devices(gb);
+}
+
+GB_result_t GB_emulator_tick_devices(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
   GB_TRY(GB_ppu_tick(gb));
   GB_TRY(GB_timer_tick(gb));
+  GB_TRY(GB_dma_tick(gb));
+  GB_TRY(GB_serial_tick(gb));
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_emulator_run_frame(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  // Runs up to the next VBlank, or one frame worth of cycles while the LCD is off
+  gb->ppu.frame_ready = false;
+  for (uint32_t t_cycle = 0; t_cycle < GB_CYCLES_PER_FRAME && !gb->ppu.frame_ready; ++t_cycle) {
+    GB_TRY(GB_emulator_tick(gb));
+  }
+
+  // Frame cut short by the LCD being switched on still has lines waiting for the line renderer
+  GB_TRY(GB_ppu_flush(gb));
 
   return GB_SUCCESS;
 }
 
+GB_result_t GB_emulator_fork(GB_emulator_t *child, GB_emulator_t *parent) {
+  if (!child || !parent) { return GB_ERROR_INVALID_EMULATOR; }
+
+  // Child takes the place of GB_emulator_init and is released with GB_emulator_free.
+  // Registers and PPU state are small and copied, memory pages are shared copy-on-write
+  child->cpu = parent->cpu;
+  child->ppu = parent->ppu;
+  child->ppu.render_pool = NULL;
+  child->timer = parent->timer;
+  child->dma = parent->dma;
+  child->serial = parent->serial;
+  GB_serial_set_output(child, NULL, NULL);  // Output belongs to the caller of the parent
+  child->joypad = parent->joypad;
+  GB_battery_init(child);  // Only the parent persists cartridge RAM
+  memset(&child->last_error, 0, sizeof(GB_error_t));
+
+  GB_TRY(GB_memory_fork(child, parent));
+
+  return GB_dma_remap(child);
+}
+
+GB_result_t GB_emulator_reset_to(GB_emulator_t *gb, const GB_emulator_t *snapshot) {
+  if (!gb || !snapshot) { return GB_ERROR_INVALID_EMULATOR; }
+
+  // Same copies as a fork in the other direction, settings of the caller are kept
+  GB_thread_pool_t *render_pool = gb->ppu.render_pool;
+  const bool render_skip = gb->ppu.render_skip;
+  const GB_serial_output_t serial_output = gb->serial.output;
+  void *serial_output_context = gb->serial.output_context;
+
+  GB_TRY(GB_memory_restore(gb, snapshot));
+  gb->cpu = snapshot->cpu;
+  gb->ppu = snapshot->ppu;
+  gb->ppu.render_pool = render_pool;
+  gb->ppu.render_skip = render_skip;
+  gb->timer = snapshot->timer;
+  gb->dma = snapshot->dma;
+  gb->serial = snapshot->serial;
+  gb->serial.output = serial_output;
+  gb->serial.output_context = serial_output_context;
+  gb->joypad = snapshot->joypad;
+
+  return GB_dma_remap(gb);
+}
+
 GB_result_t GB_emulator_load_rom(GB_emulator_t *gb, const char *path) {
   if (!gb)   { return GB_ERROR_INVALID_EMULATOR; }
   if (!path) { return GB_ERROR_INVALID_ARGUMENT; }
 
-  // Open ROM file
-  FILE *file = fopen(path, "rb");
-  if (!file) { return GB_ERROR_IO; }
-
-  // Calculate ROM size
-  fseek(file, 0, SEEK_END);
-  size_t file_size = ftell(file);
-  fseek(file, 0, SEEK_SET);
-  if (file_size < (sizeof(GB_rom_header_t) + 0x0100)) {
-    fclose(file);
-    return GB_ERROR_IO;
-  }
+  GB_rom_t *rom = NULL;
+  GB_TRY(GB_rom_load(&rom, path));
 
-  // Allocate temp ROM buffer
-  uint8_t *rom_data = malloc(file_size);
-  if (!rom_data) {
-    fclose(file);
-    return GB_ERROR_OUT_OF_MEMORY;
-  }
+  // Emulator keeps its own reference
+  const GB_result_t result = GB_emulator_attach_rom(gb, rom);
+  GB_rom_release(rom);
 
-  // Read the ROM data from the file
-  if (fread(rom_data, 1, file_size, file) != file_size) {
-    free(rom_data);
-    fclose(file);
-    return GB_ERROR_IO;
-  }
-  fclose(file);
-  
-  // Load ROM bank 0
-  gb->memory.rom_0 = malloc(0x4000);
-  if (!gb->memory.rom_0) {
-    free(rom_data);
-    return GB_ERROR_OUT_OF_MEMORY;
-  }
-  memcpy(gb->memory.rom_0, rom_data, 0x4000);
+  return result;
+}
 
-  // Read ROM header
-  GB_rom_header_t rom_header;
-  if (GB_FAILED(GB_memory_read_rom_header(gb, &rom_header))) {
-    free(rom_data);
-    return GB_ERROR_IO;
-  }
+GB_result_t GB_emulator_attach_rom(GB_emulator_t *gb, GB_rom_t *rom) {
+  if (!gb)  { return GB_ERROR_INVALID_EMULATOR; }
+  if (!rom) { return GB_ERROR_INVALID_ARGUMENT; }
 
-  // Determine the number of ROM banks based on the header
-  size_t rom_bank_count = 2;  // Default to 2 banks (32KB)
-  if (rom_header.rom_size <= 0x08) {
-    rom_bank_count = 2 << rom_header.rom_size;
-  } else {
-    free(rom_data);
-    return GB_ERROR_IO;
-  }
+  // Save of the previous cartridge is flushed before its RAM is replaced
+  GB_TRY(GB_battery_free(gb));
 
-  // Load switchable ROM banks
-  for (size_t rom_bank = 1; rom_bank < rom_bank_count; rom_bank++) {
-    const size_t offset = rom_bank * 0x4000;
-    if ((offset + 0x4000) > file_size) {
-      break;
-    }
-    gb->memory.rom_x[rom_bank - 1] = malloc(0x4000);
-    memcpy(gb->memory.rom_x[rom_bank - 1], rom_data + offset, 0x4000);
-  }
+  GB_rom_retain(rom);
+  GB_rom_release(gb->memory.rom);
+  gb->memory.rom = rom;
+  gb->memory.rom_0 = rom->data;
 
-  size_t ram_bank_count = 0;
-  switch (rom_header.ram_size) {
-    case 0x00: ram_bank_count = 0; break;
-    case 0x01: ram_bank_count = 1; break;
-    case 0x02: ram_bank_count = 1; break;
-    case 0x03: ram_bank_count = 4; break;
-    case 0x04: ram_bank_count = 16; break;
-    case 0x05: ram_bank_count = 8; break;
-    default: 
-      return GB_ERROR_IO;
-  }
+  // External RAM banks are added to the memory pages, some mappers have RAM built in
+  const GB_mbc_ops_t *mbc = GB_mbc_select(rom->header.cartridge_type);
+  GB_TRY(GB_memory_init_external_ram(gb, rom->ram_bank_count > 0 ? rom->ram_bank_count : mbc->ram_bank_count));
 
-  for (size_t i = 0; i < ram_bank_count; i++) {
-    gb->memory.external_ram[i] = malloc(0x2000);
-    if (!gb->memory.external_ram[i]) {
-      for (size_t j = 0; j < i; j++) free(gb->memory.external_ram[j]);
-      return GB_ERROR_OUT_OF_MEMORY;
-    }
-    memset(gb->memory.external_ram[i], 0, 0x2000);
+  // Init MBC
+  GB_TRY(GB_mbc_init(gb));
+  GB_TRY(GB_dma_remap(gb));
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_emulator_skip_boot(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  // Power-on state only, the boot ROM can't be skipped once it ran
+  if (gb->timer.cycles != 0 || !gb->memory.io || gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_BOOT)]) {
+    return GB_ERROR_INVALID_STATE;
   }
 
-  // Init MBC
-  gb->memory.mbc.rom_bank = 1;
-  gb->memory.mbc.ram_bank = 0;
-  gb->memory.mbc.mode = 0;
-  gb->memory.mbc.ram_enabled = false;
-
-  free(rom_data);
-
-//  gb->cpu.reg.a = 0x01;
-//  gb->cpu.reg.carry = 1;
-//  gb->cpu.reg.half_carry = 1;
-//  gb->cpu.reg.subtract = 0;
-//  gb->cpu.reg.zero = 1;
-//  gb->cpu.reg.b = 0x00;
-//  gb->cpu.reg.c = 0x13;
-//  gb->cpu.reg.d = 0x00;
-//  gb->cpu.reg.e = 0xD8;
-//  gb->cpu.reg.h = 0x01;
-//  gb->cpu.reg.l = 0x4D;
-//  gb->cpu.reg.sp = 0xFFFE;
-//  gb->cpu.reg.pc = 0x0100;
-//  gb->memory.io[0x50] = 0x01;
-//  gb->memory.io[0x40] = 0x91;
-//  gb->memory.io[0x47] = 0xE4;
+  GB_TRY(GB_memory_skip_boot(gb));
+  GB_TRY(GB_ppu_skip_boot(gb));
+
+  // Flags are left by the header checksum, which ends in zero for a valid header
+  uint8_t sum = 0x19;
+  for (uint16_t address = 0x0134; address < 0x014D; address++) { sum += gb->memory.rom_0[address]; }
+  const uint8_t checksum = gb->memory.rom_0[0x014D];
+  gb->cpu.reg.a = 0x01;
+  gb->cpu.reg.zero = (uint8_t)(sum + checksum) == 0;
+  gb->cpu.reg.subtract = 0;
+  gb->cpu.reg.half_carry = ((sum & 0x0F) + (checksum & 0x0F)) > 0x0F;
+  gb->cpu.reg.carry = (sum + checksum) > 0xFF;
+  gb->cpu.reg.bc = 0x0013;
+  gb->cpu.reg.de = 0x00D8;
+  gb->cpu.reg.hl = 0x014D;
+  gb->cpu.reg.sp = 0xFFFE;
+  gb->cpu.reg.pc = 0x0100;
+
+  // BOOT write enables interrupts and VBlank is pending, so the CPU dispatches it first
+  gb->cpu.reg.ime = 1;
+  gb->cpu.ime_pending_delay = 0;
+  gb->cpu.phase = 0;
+  gb->cpu.addr = GB_HARDWARE_REGISTER_IF;
+  gb->cpu.target = 0x0096;
+  gb->cpu.read_value = 0x01;
+  gb->cpu.write_value = 0x01;
+  GB_TRY(GB_cpu_set_instr_id(gb, GB_CPU_INSTR_ID_HANDLE_INTERRUPT));
+
+  gb->timer.div_counter = 0xABE4;
+  gb->timer.cycles = GB_CYCLES_BOOT;
 
   return GB_SUCCESS;
 }
@@ -2,23 +2,46 @@
 
 #include "defs.h"
 #include "memory.h"
+#include "rom.h"
 #include "interrupt.h"
 #include "cpu.h"
 #include "ppu.h"
 #include "timer.h"
+#include "dma.h"
+#include "serial.h"
+#include "joypad.h"
+#include "state.h"
+#include "battery.h"
 
 struct GB_emulator {
   GB_memory_t memory;
   GB_cpu_t cpu;
   GB_ppu_t ppu;
   GB_timer_t timer;
+  GB_dma_t dma;
+  GB_serial_t serial;
+  GB_joypad_t joypad;
+  GB_battery_t battery;
   GB_error_t last_error;
 };
 
 GB_result_t GB_emulator_init(GB_emulator_t *gb);
 GB_result_t GB_emulator_free(GB_emulator_t *gb);
 GB_result_t GB_emulator_tick(GB_emulator_t *gb);
+GB_result_t GB_emulator_tick_devices(GB_emulator_t *gb);  // Rest of a tick after the CPU's part
+GB_result_t GB_emulator_run_frame(GB_emulator_t *gb);
 GB_result_t GB_emulator_load_rom(GB_emulator_t *gb, const char *path);
+GB_result_t GB_emulator_attach_rom(GB_emulator_t *gb, GB_rom_t *rom);
+GB_result_t GB_emulator_fork(GB_emulator_t *child, GB_emulator_t *parent);
+
+// Starts the attached cartridge at $0100 in the state the DMG boot ROM would leave it, instead of running it.
+// Only valid before the first tick, cartridges with a bad logo start anyway
+GB_result_t GB_emulator_skip_boot(GB_emulator_t *gb);
+
+// Puts gb back in the state of snapshot, an emulator of the same cartridge, usually a fork that isn't run.
+// Pages still shared with it aren't touched. Copy-on-write pages of the snapshot replace pages gb shares
+// with others by reference, everything else is copied into gb's own pages
+GB_result_t GB_emulator_reset_to(GB_emulator_t *gb, const GB_emulator_t *snapshot);
 GB_error_t GB_emulator_get_last_error(GB_emulator_t *gb);
 void GB_emulator_set_error(GB_emulator_t *gb, GB_result_t code, const char* file, uint32_t line, const char *fmt, ...);
 
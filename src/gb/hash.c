@@ -0,0 +1,83 @@
+#include "hash.h"
+
+// CRC-32 (IEEE 802.3, reflected) processed a nibble at a time
+static const uint32_t CRC32_NIBBLE_TABLE[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t GB_hash_crc32(uint32_t crc, const void *data, size_t size) {
+  const uint8_t *bytes = data;
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= bytes[i];
+    crc = (crc >> 4) ^ CRC32_NIBBLE_TABLE[crc & 0x0F];
+    crc = (crc >> 4) ^ CRC32_NIBBLE_TABLE[crc & 0x0F];
+  }
+
+  return ~crc;
+}
+
+uint64_t GB_hash_fnv1a64(uint64_t hash, const void *data, size_t size) {
+  // Pass GB_HASH_FNV1A64_INIT to start, a previous result to continue
+  const uint8_t *bytes = data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3ull;
+  }
+
+  return hash;
+}
+
+static uint32_t rotate_left(uint32_t value, uint32_t count) {
+  return (value << count) | (value >> (32 - count));
+}
+
+static void sha1_block(uint32_t state[5], const uint8_t block[64]) {
+  uint32_t w[80];
+  for (uint32_t i = 0; i < 16; i++) {
+    w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 | (uint32_t)block[i * 4 + 2] << 8 | block[i * 4 + 3];
+  }
+  for (uint32_t i = 16; i < 80; i++) { w[i] = rotate_left(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1); }
+
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+  for (uint32_t i = 0; i < 80; i++) {
+    uint32_t f, k;
+    if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+    else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+    else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+    else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+    const uint32_t temp = rotate_left(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = rotate_left(b, 30);
+    b = a;
+    a = temp;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+void GB_hash_sha1(const void *data, size_t size, uint8_t digest[GB_HASH_SHA1_SIZE]) {
+  // Identifies ROM images, not meant to be fast
+  uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+  const uint8_t *bytes = data;
+  size_t offset = 0;
+  for (; offset + 64 <= size; offset += 64) { sha1_block(state, bytes + offset); }
+
+  // Tail, a one bit and the length in bits fill the last one or two blocks
+  uint8_t block[128] = { 0 };
+  const size_t tail = size - offset;
+  memcpy(block, bytes + offset, tail);
+  block[tail] = 0x80;
+  const size_t block_size = tail < 56 ? 64 : 128;
+  const uint64_t bits = (uint64_t)size * 8;
+  for (uint32_t i = 0; i < 8; i++) { block[block_size - 1 - i] = (uint8_t)(bits >> (i * 8)); }
+  sha1_block(state, block);
+  if (block_size == 128) { sha1_block(state, block + 64); }
+
+  for (uint32_t i = 0; i < GB_HASH_SHA1_SIZE; i++) { digest[i] = (uint8_t)(state[i / 4] >> (24 - (i % 4) * 8)); }
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "defs.h"
+
+#define GB_HASH_FNV1A64_INIT (0xCBF29CE484222325ull)
+#define GB_HASH_SHA1_SIZE    (20)
+
+uint32_t GB_hash_crc32(uint32_t crc, const void *data, size_t size);
+uint64_t GB_hash_fnv1a64(uint64_t hash, const void *data, size_t size);
+void GB_hash_sha1(const void *data, size_t size, uint8_t digest[GB_HASH_SHA1_SIZE]);
@@ -0,0 +1,44 @@
+#include "joypad.h"
+#include "gb.h"  // IWYU pragma: keep
+
+static uint8_t selected_lines(GB_emulator_t *gb, uint8_t buttons) {
+  const uint8_t p1 = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_P1JOYP)];
+  uint8_t lines = 0x0F;  // All buttons released (active low)
+  if (!(p1 & (1 << 4))) { lines &= ~(buttons & 0x0F); }         // D-pad
+  if (!(p1 & (1 << 5))) { lines &= ~((buttons >> 4) & 0x0F); }  // Buttons
+
+  return lines;
+}
+
+GB_result_t GB_joypad_init(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  gb->joypad.buttons = 0;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_joypad_free(GB_emulator_t *gb) {
+  return GB_joypad_init(gb);
+}
+
+GB_result_t GB_joypad_set_buttons(GB_emulator_t *gb, uint8_t buttons) {
+  if (!gb)            { return GB_ERROR_INVALID_EMULATOR; }
+  if (!gb->memory.io) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Interrupt is requested when any selected line goes from high to low
+  const uint8_t prev_lines = selected_lines(gb, gb->joypad.buttons);
+  const uint8_t lines = selected_lines(gb, buttons);
+  gb->joypad.buttons = buttons;
+  if (prev_lines & ~lines) {
+    GB_TRY(GB_interrupt_request(gb, GB_INTERRUPT_JOYPAD));
+  }
+
+  return GB_SUCCESS;
+}
+
+uint8_t GB_joypad_read(GB_emulator_t *gb) {
+  // Only the select bits are writable, unused bits read as 1
+  const uint8_t p1 = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_P1JOYP)];
+  return 0xC0 | (p1 & 0x30) | selected_lines(gb, gb->joypad.buttons);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "defs.h"
+
+#define GB_JOYPAD_RIGHT   (1 << 0)
+#define GB_JOYPAD_LEFT    (1 << 1)
+#define GB_JOYPAD_UP      (1 << 2)
+#define GB_JOYPAD_DOWN    (1 << 3)
+#define GB_JOYPAD_A       (1 << 4)
+#define GB_JOYPAD_B       (1 << 5)
+#define GB_JOYPAD_SELECT  (1 << 6)
+#define GB_JOYPAD_START   (1 << 7)
+
+typedef struct {
+  uint8_t buttons;  // Pressed buttons, GB_JOYPAD_* mask
+} GB_joypad_t;
+
+GB_result_t GB_joypad_init(GB_emulator_t *gb);
+GB_result_t GB_joypad_free(GB_emulator_t *gb);
+GB_result_t GB_joypad_set_buttons(GB_emulator_t *gb, uint8_t buttons);
+uint8_t GB_joypad_read(GB_emulator_t *gb);
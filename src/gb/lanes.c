@@ -0,0 +1,200 @@
+#include "lanes.h"
+#include "gb.h"  // IWYU pragma: keep
+
+// One register of every lane, GCC and Clang lower the operations to SSE2, AVX2 or NEON
+typedef uint8_t lane_vector_t __attribute__((vector_size(GB_LANES_MAX)));
+
+#define OPERAND_HL (6)  // Register code of the (HL) memory operand
+#define OPERAND_A  (7)
+
+#define FLAG_ZERO       (0x80)
+#define FLAG_SUBTRACT   (0x40)
+#define FLAG_HALF_CARRY (0x20)
+#define FLAG_CARRY      (0x10)
+
+typedef enum {
+  ALU_ADD,
+  ALU_ADC,
+  ALU_SUB,
+  ALU_SBC,
+  ALU_AND,
+  ALU_XOR,
+  ALU_OR,
+  ALU_CP
+} alu_op_t;
+
+typedef struct {
+  lane_vector_t r[8];  // By register code: B, C, D, E, H, L, unused for (HL), A
+  lane_vector_t f;
+} lane_registers_t;
+
+static bool is_vector_opcode(uint8_t opcode) {
+  // NOP, INC r, DEC r, LD r, r' and ALU A, r only touch registers, (HL) operands and HALT don't
+  const uint8_t y = (opcode >> 3) & 0x07;
+  const uint8_t z = opcode & 0x07;
+  switch (opcode >> 6) {
+    case 0:  return opcode == 0x00 || ((z == 4 || z == 5) && y != OPERAND_HL);
+    case 1:  return y != OPERAND_HL && z != OPERAND_HL;
+    case 2:  return z != OPERAND_HL;
+    default: return false;
+  }
+}
+
+static void gather(lane_registers_t *reg, const GB_emulator_t *lanes, uint32_t count, uint32_t selected) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (!(selected & (1u << i))) { continue; }
+    const GB_register_file_t *file = &lanes[i].cpu.reg;
+    reg->r[0][i] = file->b;
+    reg->r[1][i] = file->c;
+    reg->r[2][i] = file->d;
+    reg->r[3][i] = file->e;
+    reg->r[4][i] = file->h;
+    reg->r[5][i] = file->l;
+    reg->r[OPERAND_A][i] = file->a;
+    reg->f[i] = file->f;
+  }
+}
+
+static void scatter(GB_emulator_t *lanes, uint32_t count, uint32_t selected, const lane_registers_t *reg) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (!(selected & (1u << i))) { continue; }
+    GB_register_file_t *file = &lanes[i].cpu.reg;
+    file->b = reg->r[0][i];
+    file->c = reg->r[1][i];
+    file->d = reg->r[2][i];
+    file->e = reg->r[3][i];
+    file->h = reg->r[4][i];
+    file->l = reg->r[5][i];
+    file->a = reg->r[OPERAND_A][i];
+    file->f = reg->f[i];
+  }
+}
+
+static void inc_dec(lane_registers_t *reg, uint8_t code, bool dec) {
+  // Carry is kept, the half carry is set when the low nibble wraps
+  const lane_vector_t value = reg->r[code];
+  const lane_vector_t result = dec ? value - 1 : value + 1;
+  const lane_vector_t wrapped = dec ? value : result;
+  lane_vector_t flags = ((lane_vector_t)((wrapped & 0x0F) == 0) & FLAG_HALF_CARRY) |
+                        ((lane_vector_t)(result == 0) & FLAG_ZERO);
+  if (dec) { flags |= FLAG_SUBTRACT; }
+
+  reg->r[code] = result;
+  reg->f = (reg->f & (FLAG_CARRY | 0x0F)) | flags;
+}
+
+static void alu(lane_registers_t *reg, alu_op_t op, lane_vector_t value) {
+  // Carry out of every bit follows from the operands and the result, bit 3 gives the half carry
+  // and bit 7 the carry, borrows of a subtraction likewise
+  const lane_vector_t a = reg->r[OPERAND_A];
+  const lane_vector_t zero = { 0 };
+  const lane_vector_t carry = (op == ALU_ADC || op == ALU_SBC) ? (reg->f >> 4) & 0x01 : zero;
+  lane_vector_t result = zero;
+  lane_vector_t flags = zero;
+  switch (op) {
+    case ALU_ADD:
+    case ALU_ADC: {
+      result = a + value + carry;
+      const lane_vector_t carries = (a & value) | ((a | value) & ~result);
+      flags = ((carries << 2) & FLAG_HALF_CARRY) | ((carries >> 3) & FLAG_CARRY);
+      break;
+    }
+    case ALU_SUB:
+    case ALU_SBC:
+    case ALU_CP: {
+      result = a - value - carry;
+      const lane_vector_t borrows = (~a & value) | ((~a | value) & result);
+      flags = ((borrows << 2) & FLAG_HALF_CARRY) | ((borrows >> 3) & FLAG_CARRY) | FLAG_SUBTRACT;
+      break;
+    }
+    case ALU_AND:
+      result = a & value;
+      flags = zero | FLAG_HALF_CARRY;
+      break;
+    case ALU_XOR:
+      result = a ^ value;
+      break;
+    case ALU_OR:
+      result = a | value;
+      break;
+  }
+  flags |= (lane_vector_t)(result == 0) & FLAG_ZERO;
+
+  if (op != ALU_CP) { reg->r[OPERAND_A] = result; }
+  reg->f = (reg->f & 0x0F) | flags;
+}
+
+static void execute(lane_registers_t *reg, uint8_t opcode) {
+  const uint8_t y = (opcode >> 3) & 0x07;
+  const uint8_t z = opcode & 0x07;
+  if (opcode == 0x00) { return; }
+
+  switch (opcode >> 6) {
+    case 0: inc_dec(reg, y, z == 5);   break;
+    case 1: reg->r[y] = reg->r[z];     break;
+    case 2: alu(reg, (alu_op_t)y, reg->r[z]); break;
+  }
+}
+
+GB_result_t GB_lanes_run_frame(GB_emulator_t *lanes, uint32_t count, GB_lanes_stats_t *stats) {
+  if (!lanes || count == 0 || count > GB_LANES_MAX) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Same loop as GB_emulator_run_frame, a lane stops at its VBlank
+  GB_lanes_stats_t counted = { 0 };
+  uint32_t running = (1u << count) - 1;
+  for (uint32_t i = 0; i < count; i++) { lanes[i].ppu.frame_ready = false; }
+  for (uint32_t t_cycle = 0; t_cycle < GB_CYCLES_PER_FRAME && running; ++t_cycle) {
+    // Lanes dispatching the register instruction of the first one wait for the vector step,
+    // lanes that diverged in control flow or memory access run their own instruction
+    uint32_t selected = 0;
+    uint32_t selected_count = 0;
+    uint8_t selected_opcode = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      if (!(running & (1u << i))) { continue; }
+      GB_emulator_t *gb = &lanes[i];
+      uint8_t opcode = 0;
+      if (GB_cpu_decoded_opcode(gb, &opcode)) {
+        counted.instrs++;
+        if (is_vector_opcode(opcode) && (selected_count == 0 || opcode == selected_opcode)) {
+          selected |= 1u << i;
+          selected_count++;
+          selected_opcode = opcode;
+          continue;
+        }
+      }
+      GB_TRY(GB_emulator_tick(gb));
+      if (gb->ppu.frame_ready) { running &= ~(1u << i); }
+    }
+    if (selected_count == 0) { continue; }
+
+    // A lone lane isn't worth the gather
+    const bool vector = selected_count > 1;
+    if (vector) {
+      lane_registers_t reg = { 0 };
+      gather(&reg, lanes, count, selected);
+      execute(&reg, selected_opcode);
+      scatter(lanes, count, selected, &reg);
+      counted.vector_instrs += selected_count;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      if (!(selected & (1u << i))) { continue; }
+      GB_emulator_t *gb = &lanes[i];
+      if (vector) {
+        GB_TRY(GB_cpu_finish_instr(gb));
+        GB_TRY(GB_emulator_tick_devices(gb));
+      } else {
+        GB_TRY(GB_emulator_tick(gb));
+      }
+      if (gb->ppu.frame_ready) { running &= ~(1u << i); }
+    }
+  }
+
+  // Frames cut short by the LCD being switched on still have lines waiting for the line renderer
+  for (uint32_t i = 0; i < count; i++) { GB_TRY(GB_ppu_flush(&lanes[i])); }
+  if (stats) {
+    stats->instrs += counted.instrs;
+    stats->vector_instrs += counted.vector_instrs;
+  }
+
+  return GB_SUCCESS;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "defs.h"
+
+#define GB_LANES_MAX (16)  // One byte of every lane fills a 128-bit vector register
+
+typedef struct {
+  uint64_t instrs;          // Instructions dispatched on all lanes
+  uint64_t vector_instrs;   // Of them executed together with other lanes
+} GB_lanes_stats_t;
+
+// Runs a frame on each of count emulators of the same ROM, one T-cycle on all of them at a time.
+// Lanes dispatching the same register instruction in a cycle execute it at once on a structure
+// of arrays register file, the others run on the scalar core. Every lane ends where
+// GB_emulator_run_frame would, stats may be NULL
+GB_result_t GB_lanes_run_frame(GB_emulator_t *lanes, uint32_t count, GB_lanes_stats_t *stats);
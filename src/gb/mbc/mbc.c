@@ -0,0 +1,80 @@
+#include "mbc.h"
+#include "../gb.h"  // IWYU pragma: keep
+
+const GB_mbc_ops_t *GB_mbc_select(uint8_t cartridge_type) {
+  switch (cartridge_type) {
+    case 0x00:  // ROM ONLY
+    case 0x08:  // ROM+RAM
+    case 0x09:  // ROM+RAM+BATTERY
+      return &GB_MBC_NONE;
+    case 0x05:  // MBC2
+    case 0x06:  // MBC2+BATTERY
+      return &GB_MBC_MBC2;
+    case 0x0F:  // MBC3+TIMER+BATTERY
+    case 0x10:  // MBC3+TIMER+RAM+BATTERY
+      return &GB_MBC_MBC3_RTC;
+    case 0x11:  // MBC3
+    case 0x12:  // MBC3+RAM
+    case 0x13:  // MBC3+RAM+BATTERY
+      return &GB_MBC_MBC3;
+    case 0x19:  // MBC5
+    case 0x1A:  // MBC5+RAM
+    case 0x1B:  // MBC5+RAM+BATTERY
+    case 0x1C:  // MBC5+RUMBLE
+    case 0x1D:  // MBC5+RUMBLE+RAM
+    case 0x1E:  // MBC5+RUMBLE+RAM+BATTERY
+      return &GB_MBC_MBC5;
+    default:
+      // MBC1 and mappers that are not emulated yet, which used to run as MBC1
+      return &GB_MBC_MBC1;
+  }
+}
+
+GB_result_t GB_mbc_init(GB_emulator_t *gb) {
+  if (!gb)             { return GB_ERROR_INVALID_EMULATOR; }
+  if (!gb->memory.rom) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  GB_mbc_t *mbc = &gb->memory.mbc;
+  mbc->ops = GB_mbc_select(gb->memory.rom->header.cartridge_type);
+  mbc->rom_bank = 1;
+  mbc->ram_bank = 0;
+  mbc->mode = 0;
+  mbc->ram_enabled = false;
+  mbc->ram_address_mask = 0x1FFF;
+  mbc->ram_value_mask = 0x00;
+  GB_TRY(GB_rtc_init(gb));
+
+  return GB_mbc_remap(gb);
+}
+
+GB_result_t GB_mbc_write(GB_emulator_t *gb, uint16_t addr, uint8_t value) {
+  if (!gb)                  { return GB_ERROR_INVALID_EMULATOR; }
+  if (!gb->memory.mbc.ops)  { return GB_SUCCESS; }
+
+  gb->memory.mbc.ops->write(gb, addr, value);
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_mbc_remap(GB_emulator_t *gb) {
+  if (!gb)                  { return GB_ERROR_INVALID_EMULATOR; }
+  if (!gb->memory.mbc.ops)  { return GB_SUCCESS; }
+
+  gb->memory.mbc.ops->map(gb);
+
+  return GB_SUCCESS;
+}
+
+void GB_mbc_map_rom(GB_emulator_t *gb, uint16_t bank_0, uint16_t bank_x) {
+  // Bank numbers wrap around the ROM size, like the unconnected upper address lines do
+  const GB_rom_t *rom = gb->memory.rom;
+  gb->memory.rom_0 = rom->data + (size_t)(bank_0 % rom->bank_count) * 0x4000;
+  gb->memory.mbc.rom_x = rom->data + (size_t)(bank_x % rom->bank_count) * 0x4000;
+}
+
+void GB_mbc_map_ram(GB_emulator_t *gb, bool enabled, uint8_t bank) {
+  const uint8_t bank_count = gb->memory.external_ram_bank_count;
+  gb->memory.mbc.ram_page = enabled && bank_count > 0 ?
+                            GB_MEMORY_PAGE_EXTERNAL_RAM + (bank % bank_count) * 2 :
+                            GB_MBC_RAM_UNMAPPED;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../defs.h"
+#include "rtc.h"
+
+#define GB_MBC_RAM_UNMAPPED (0xFF)  // $A000:$BFFF reads 0xFF and ignores writes
+#define GB_MBC_RAM_RTC      (0xFE)  // $A000:$BFFF is the selected RTC register
+
+typedef struct GB_mbc_ops GB_mbc_ops_t;
+
+typedef struct {
+  const GB_mbc_ops_t *ops;  // Mapper of the attached cartridge
+  uint16_t rom_bank;        // ROM bank register (MBC1: lower 5 bits only)
+  uint8_t ram_bank;         // RAM bank register (MBC1: upper 2 bits, MBC3: also RTC select)
+  uint8_t mode;             // Banking mode (MBC1 only)
+  bool ram_enabled;         // Flag to enable/disable access to the RAM
+
+  // Windows recomputed on every register write, so reads never look at the registers
+  const uint8_t *rom_x;       // $4000:$7FFF
+  uint8_t ram_page;           // First memory page of $A000:$BFFF or GB_MBC_RAM_UNMAPPED
+  uint16_t ram_address_mask;  // RAM smaller than 8KB is mirrored across the window
+  uint8_t ram_value_mask;     // Bits that always read as 1
+
+  GB_rtc_t rtc;               // MBC3 clock
+} GB_mbc_t;
+
+struct GB_mbc_ops {
+  const char *name;
+  uint8_t ram_bank_count;   // Built-in RAM banks, used when the header declares none
+  bool has_rtc;
+  void (*write)(GB_emulator_t *gb, uint16_t addr, uint8_t value);  // $0000:$7FFF register or GB_MBC_RAM_RTC write
+  void (*map)(GB_emulator_t *gb);                                   // Recomputes the windows from the registers
+};
+
+extern const GB_mbc_ops_t GB_MBC_NONE;
+extern const GB_mbc_ops_t GB_MBC_MBC1;
+extern const GB_mbc_ops_t GB_MBC_MBC2;
+extern const GB_mbc_ops_t GB_MBC_MBC3;
+extern const GB_mbc_ops_t GB_MBC_MBC3_RTC;
+extern const GB_mbc_ops_t GB_MBC_MBC5;
+
+const GB_mbc_ops_t *GB_mbc_select(uint8_t cartridge_type);
+GB_result_t GB_mbc_init(GB_emulator_t *gb);
+GB_result_t GB_mbc_write(GB_emulator_t *gb, uint16_t addr, uint8_t value);
+GB_result_t GB_mbc_remap(GB_emulator_t *gb);
+
+// Helpers for the mapper implementations
+void GB_mbc_map_rom(GB_emulator_t *gb, uint16_t bank_0, uint16_t bank_x);
+void GB_mbc_map_ram(GB_emulator_t *gb, bool enabled, uint8_t bank);
@@ -0,0 +1,37 @@
+#include "mbc.h"
+#include "../gb.h"  // IWYU pragma: keep
+
+static void write(GB_emulator_t *gb, uint16_t addr, uint8_t value) {
+  GB_mbc_t *mbc = &gb->memory.mbc;
+  if (addr < 0x2000) {
+    // RAM enable/disable
+    mbc->ram_enabled = (value & 0x0F) == 0x0A;
+  } else if (addr < 0x4000) {
+    // ROM bank lower 5 bits, bank 0 cannot be selected
+    mbc->rom_bank = value & 0x1F;
+    if (mbc->rom_bank == 0) { mbc->rom_bank = 1; }
+  } else if (addr < 0x6000) {
+    // RAM bank number or upper ROM bank bits, both share one register
+    mbc->ram_bank = value & 0x03;
+  } else {
+    // Mode select
+    mbc->mode = value & 0x01;
+  }
+
+  gb->memory.mbc.ops->map(gb);
+}
+
+static void map(GB_emulator_t *gb) {
+  // Upper bits select the ROM bank, and in mode 1 also the $0000 bank and the RAM bank
+  const GB_mbc_t *mbc = &gb->memory.mbc;
+  const uint16_t upper_bank = (uint16_t)mbc->ram_bank << 5;
+  GB_mbc_map_rom(gb, mbc->mode ? upper_bank : 0, upper_bank | mbc->rom_bank);
+  GB_mbc_map_ram(gb, mbc->ram_enabled, mbc->mode ? mbc->ram_bank : 0);
+}
+
+const GB_mbc_ops_t GB_MBC_MBC1 = {
+  .name = "MBC1",
+  .ram_bank_count = 0,
+  .write = write,
+  .map = map
+};
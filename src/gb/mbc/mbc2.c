@@ -0,0 +1,33 @@
+#include "mbc.h"
+#include "../gb.h"  // IWYU pragma: keep
+
+static void write(GB_emulator_t *gb, uint16_t addr, uint8_t value) {
+  if (addr >= 0x4000) { return; }
+
+  // Address bit 8 selects between RAM enable and ROM bank
+  GB_mbc_t *mbc = &gb->memory.mbc;
+  if (!(addr & 0x0100)) {
+    mbc->ram_enabled = (value & 0x0F) == 0x0A;
+  } else {
+    mbc->rom_bank = value & 0x0F;
+    if (mbc->rom_bank == 0) { mbc->rom_bank = 1; }
+  }
+
+  gb->memory.mbc.ops->map(gb);
+}
+
+static void map(GB_emulator_t *gb) {
+  // Built-in 512 x 4 bit RAM is mirrored across the window, upper nibble reads as 1
+  GB_mbc_t *mbc = &gb->memory.mbc;
+  mbc->ram_address_mask = 0x01FF;
+  mbc->ram_value_mask = 0xF0;
+  GB_mbc_map_rom(gb, 0, mbc->rom_bank);
+  GB_mbc_map_ram(gb, mbc->ram_enabled, 0);
+}
+
+const GB_mbc_ops_t GB_MBC_MBC2 = {
+  .name = "MBC2",
+  .ram_bank_count = 1,
+  .write = write,
+  .map = map
+};
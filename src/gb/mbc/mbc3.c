@@ -0,0 +1,55 @@
+#include "mbc.h"
+#include "../gb.h"  // IWYU pragma: keep
+
+static void write(GB_emulator_t *gb, uint16_t addr, uint8_t value) {
+  GB_mbc_t *mbc = &gb->memory.mbc;
+  if (addr >= 0xA000) {
+    // Selected RTC register
+    GB_rtc_write(gb, mbc->ram_bank - 0x08, value);
+    return;
+  }
+
+  if (addr < 0x2000) {
+    // RAM and RTC enable/disable
+    mbc->ram_enabled = (value & 0x0F) == 0x0A;
+  } else if (addr < 0x4000) {
+    // ROM bank 7 bits, bank 0 cannot be selected
+    mbc->rom_bank = value & 0x7F;
+    if (mbc->rom_bank == 0) { mbc->rom_bank = 1; }
+  } else if (addr < 0x6000) {
+    // RAM bank 0-3 or RTC register 0x08-0x0C
+    mbc->ram_bank = value;
+  } else {
+    // Writing 0 then 1 copies the clock into the readable registers
+    if (mbc->ops->has_rtc) { GB_rtc_latch(gb, value); }
+    return;
+  }
+
+  gb->memory.mbc.ops->map(gb);
+}
+
+static void map(GB_emulator_t *gb) {
+  // Without a clock the RTC registers are not connected and read as 0xFF
+  GB_mbc_t *mbc = &gb->memory.mbc;
+  GB_mbc_map_rom(gb, 0, mbc->rom_bank);
+  GB_mbc_map_ram(gb, mbc->ram_enabled && mbc->ram_bank < 0x08, mbc->ram_bank);
+  if (mbc->ops->has_rtc && mbc->ram_enabled && mbc->ram_bank >= 0x08 && mbc->ram_bank <= 0x0C) {
+    mbc->ram_page = GB_MBC_RAM_RTC;
+  }
+}
+
+const GB_mbc_ops_t GB_MBC_MBC3 = {
+  .name = "MBC3",
+  .ram_bank_count = 0,
+  .has_rtc = false,
+  .write = write,
+  .map = map
+};
+
+const GB_mbc_ops_t GB_MBC_MBC3_RTC = {
+  .name = "MBC3+RTC",
+  .ram_bank_count = 0,
+  .has_rtc = true,
+  .write = write,
+  .map = map
+};
@@ -0,0 +1,36 @@
+#include "mbc.h"
+#include "../gb.h"  // IWYU pragma: keep
+
+static void write(GB_emulator_t *gb, uint16_t addr, uint8_t value) {
+  GB_mbc_t *mbc = &gb->memory.mbc;
+  if (addr < 0x2000) {
+    // RAM enable/disable
+    mbc->ram_enabled = (value & 0x0F) == 0x0A;
+  } else if (addr < 0x3000) {
+    // ROM bank lower 8 bits, bank 0 can be selected
+    mbc->rom_bank = (mbc->rom_bank & 0x100) | value;
+  } else if (addr < 0x4000) {
+    // ROM bank 9th bit
+    mbc->rom_bank = (mbc->rom_bank & 0xFF) | ((uint16_t)(value & 0x01) << 8);
+  } else if (addr < 0x6000) {
+    // RAM bank, bit 3 drives the motor on rumble cartridges
+    mbc->ram_bank = value & 0x0F;
+  } else {
+    return;
+  }
+
+  gb->memory.mbc.ops->map(gb);
+}
+
+static void map(GB_emulator_t *gb) {
+  const GB_mbc_t *mbc = &gb->memory.mbc;
+  GB_mbc_map_rom(gb, 0, mbc->rom_bank);
+  GB_mbc_map_ram(gb, mbc->ram_enabled, mbc->ram_bank);
+}
+
+const GB_mbc_ops_t GB_MBC_MBC5 = {
+  .name = "MBC5",
+  .ram_bank_count = 0,
+  .write = write,
+  .map = map
+};
@@ -0,0 +1,23 @@
+#include "mbc.h"
+#include "../gb.h"  // IWYU pragma: keep
+
+static void write(GB_emulator_t *gb, uint16_t addr, uint8_t value) {
+  // No registers, writes to ROM are ignored
+  (void)gb;
+  (void)addr;
+  (void)value;
+}
+
+static void map(GB_emulator_t *gb) {
+  // Optional RAM is always accessible
+  gb->memory.mbc.ram_enabled = true;
+  GB_mbc_map_rom(gb, 0, 1);
+  GB_mbc_map_ram(gb, true, 0);
+}
+
+const GB_mbc_ops_t GB_MBC_NONE = {
+  .name = "ROM",
+  .ram_bank_count = 0,
+  .write = write,
+  .map = map
+};
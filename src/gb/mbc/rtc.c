@@ -0,0 +1,132 @@
+#include "rtc.h"
+#include "../gb.h"  // IWYU pragma: keep
+#include <time.h>
+
+#define SECONDS_PER_DAY (24 * 60 * 60)
+
+static const uint8_t REGISTER_MASKS[GB_RTC_REGISTER_COUNT] = { 0x3F, 0x3F, 0x1F, 0xFF, 0xC1 };
+
+static int64_t base_time(const GB_rtc_t *rtc) {
+  // Emulated clock doesn't keep host time, so its state is reproducible
+  return rtc->source == GB_RTC_SOURCE_HOST ? (int64_t)time(NULL) : 0;
+}
+
+static uint64_t elapsed_cycles(GB_emulator_t *gb) {
+  const GB_rtc_t *rtc = &gb->memory.mbc.rtc;
+  if (rtc->source == GB_RTC_SOURCE_HOST) {
+    const int64_t elapsed = (int64_t)time(NULL) - rtc->base_time;
+    return elapsed > 0 ? (uint64_t)elapsed * GB_CYCLES_PER_SECOND : 0;
+  }
+
+  return gb->timer.cycles - rtc->base_cycles;
+}
+
+static void rebase(GB_emulator_t *gb, bool keep_subsecond) {
+  // Current value becomes the new base, the part of the running second can be carried over
+  GB_rtc_t *rtc = &gb->memory.mbc.rtc;
+  const bool halted = rtc->base[GB_RTC_DAY_HIGH] & GB_RTC_DAY_HIGH_HALT;
+  const uint64_t subsecond = keep_subsecond && !halted ? elapsed_cycles(gb) % GB_CYCLES_PER_SECOND : 0;
+  GB_rtc_now(gb, rtc->base);
+  rtc->base_cycles = gb->timer.cycles - subsecond;
+  rtc->base_time = base_time(rtc);
+}
+
+static void write_le(uint8_t *out, uint64_t value, uint8_t size) {
+  for (uint8_t i = 0; i < size; i++) { out[i] = (uint8_t)(value >> (i * 8)); }
+}
+
+static uint64_t read_le(const uint8_t *in, uint8_t size) {
+  uint64_t value = 0;
+  for (uint8_t i = 0; i < size; i++) { value |= (uint64_t)in[i] << (i * 8); }
+
+  return value;
+}
+
+GB_result_t GB_rtc_init(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  GB_rtc_t *rtc = &gb->memory.mbc.rtc;
+  const uint8_t source = rtc->source;
+  memset(rtc, 0, sizeof(GB_rtc_t));
+  rtc->source = source;
+  rtc->base_cycles = gb->timer.cycles;
+  rtc->base_time = base_time(rtc);
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_rtc_set_source(GB_emulator_t *gb, GB_rtc_source_t source) {
+  if (!gb)                              { return GB_ERROR_INVALID_EMULATOR; }
+  if (source > GB_RTC_SOURCE_HOST)      { return GB_ERROR_INVALID_ARGUMENT; }
+  if (gb->memory.mbc.rtc.source == source) { return GB_SUCCESS; }
+
+  // Clock keeps its value, only the way time passes changes
+  rebase(gb, false);
+  gb->memory.mbc.rtc.source = source;
+  gb->memory.mbc.rtc.base_time = base_time(&gb->memory.mbc.rtc);
+
+  return GB_SUCCESS;
+}
+
+void GB_rtc_now(GB_emulator_t *gb, uint8_t registers[GB_RTC_REGISTER_COUNT]) {
+  const GB_rtc_t *rtc = &gb->memory.mbc.rtc;
+  memcpy(registers, rtc->base, GB_RTC_REGISTER_COUNT);
+  if (rtc->base[GB_RTC_DAY_HIGH] & GB_RTC_DAY_HIGH_HALT) { return; }
+
+  const uint64_t base_day = rtc->base[GB_RTC_DAY_LOW] | ((uint64_t)(rtc->base[GB_RTC_DAY_HIGH] & 0x01) << 8);
+  const uint64_t seconds = rtc->base[GB_RTC_SECONDS] +
+                           rtc->base[GB_RTC_MINUTES] * 60ull +
+                           rtc->base[GB_RTC_HOURS] * 3600ull +
+                           base_day * SECONDS_PER_DAY +
+                           elapsed_cycles(gb) / GB_CYCLES_PER_SECOND;
+
+  // Day counter overflows after 511 and sets the sticky carry
+  const uint64_t day = seconds / SECONDS_PER_DAY;
+  registers[GB_RTC_SECONDS] = seconds % 60;
+  registers[GB_RTC_MINUTES] = (seconds / 60) % 60;
+  registers[GB_RTC_HOURS] = (seconds / 3600) % 24;
+  registers[GB_RTC_DAY_LOW] = day & 0xFF;
+  registers[GB_RTC_DAY_HIGH] = (rtc->base[GB_RTC_DAY_HIGH] & GB_RTC_DAY_HIGH_CARRY) |
+                               ((day >> 8) & 0x01) |
+                               (day > 0x1FF ? GB_RTC_DAY_HIGH_CARRY : 0);
+}
+
+void GB_rtc_latch(GB_emulator_t *gb, uint8_t value) {
+  GB_rtc_t *rtc = &gb->memory.mbc.rtc;
+  if (rtc->latch_value == 0x00 && value == 0x01) { GB_rtc_now(gb, rtc->latched); }
+  rtc->latch_value = value;
+}
+
+void GB_rtc_write(GB_emulator_t *gb, uint8_t reg, uint8_t value) {
+  if (reg >= GB_RTC_REGISTER_COUNT) { return; }
+
+  // Writing the seconds also resets the divider of the running second
+  GB_rtc_t *rtc = &gb->memory.mbc.rtc;
+  rebase(gb, reg != GB_RTC_SECONDS);
+  rtc->base[reg] = value & REGISTER_MASKS[reg];
+  rtc->latched[reg] = rtc->base[reg];
+  gb->memory.external_ram_dirty = true;
+}
+
+void GB_rtc_save_trailer(GB_emulator_t *gb, uint8_t trailer[GB_RTC_SAV_TRAILER_SIZE]) {
+  // Same layout as other emulators: 32-bit registers, latched registers and a 64-bit timestamp
+  uint8_t registers[GB_RTC_REGISTER_COUNT];
+  GB_rtc_now(gb, registers);
+  for (uint8_t i = 0; i < GB_RTC_REGISTER_COUNT; i++) {
+    write_le(trailer + i * 4, registers[i], 4);
+    write_le(trailer + 20 + i * 4, gb->memory.mbc.rtc.latched[i], 4);
+  }
+  write_le(trailer + 40, (uint64_t)time(NULL), 8);
+}
+
+void GB_rtc_load_trailer(GB_emulator_t *gb, const uint8_t trailer[GB_RTC_SAV_TRAILER_SIZE]) {
+  // Host clock catches up with the time the emulator was not running, emulated clock doesn't
+  GB_rtc_t *rtc = &gb->memory.mbc.rtc;
+  for (uint8_t i = 0; i < GB_RTC_REGISTER_COUNT; i++) {
+    rtc->base[i] = (uint8_t)read_le(trailer + i * 4, 4) & REGISTER_MASKS[i];
+    rtc->latched[i] = (uint8_t)read_le(trailer + 20 + i * 4, 4) & REGISTER_MASKS[i];
+  }
+  rtc->base_cycles = gb->timer.cycles;
+  rtc->base_time = rtc->source == GB_RTC_SOURCE_HOST ? (int64_t)read_le(trailer + 40, 8) : 0;
+  if (rtc->base_time == 0) { rtc->base_time = base_time(rtc); }  // Trailer of a new save file
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../defs.h"
+
+#define GB_RTC_SECONDS          (0)
+#define GB_RTC_MINUTES          (1)
+#define GB_RTC_HOURS            (2)
+#define GB_RTC_DAY_LOW          (3)
+#define GB_RTC_DAY_HIGH         (4)  // Bit 0: day bit 8, bit 6: halt, bit 7: day carry
+#define GB_RTC_REGISTER_COUNT   (5)
+#define GB_RTC_DAY_HIGH_HALT    (1 << 6)
+#define GB_RTC_DAY_HIGH_CARRY   (1 << 7)
+#define GB_RTC_SAV_TRAILER_SIZE (48)  // Registers, latched registers and a UNIX timestamp appended to .sav files
+
+typedef enum {
+  GB_RTC_SOURCE_EMULATED = 0,  // Clock follows emulated cycles, runs are deterministic
+  GB_RTC_SOURCE_HOST           // Clock follows the host wall clock, also while the emulator is not running
+} GB_rtc_source_t;
+
+typedef struct {
+  // Clock is never ticked, its value is derived from a base point when latched
+  uint8_t base[GB_RTC_REGISTER_COUNT];
+  uint64_t base_cycles;     // Emulated T-cycle counter at the base point
+  int64_t base_time;        // Host UNIX time at the base point, 0 for the emulated clock
+  uint8_t latched[GB_RTC_REGISTER_COUNT];
+  uint8_t latch_value;      // Last write to $6000:$7FFF, 0 followed by 1 latches the clock
+  uint8_t source;           // GB_rtc_source_t
+} GB_rtc_t;
+
+GB_result_t GB_rtc_init(GB_emulator_t *gb);
+GB_result_t GB_rtc_set_source(GB_emulator_t *gb, GB_rtc_source_t source);
+void GB_rtc_now(GB_emulator_t *gb, uint8_t registers[GB_RTC_REGISTER_COUNT]);
+void GB_rtc_latch(GB_emulator_t *gb, uint8_t value);
+void GB_rtc_write(GB_emulator_t *gb, uint8_t reg, uint8_t value);
+void GB_rtc_save_trailer(GB_emulator_t *gb, uint8_t trailer[GB_RTC_SAV_TRAILER_SIZE]);
+void GB_rtc_load_trailer(GB_emulator_t *gb, const uint8_t trailer[GB_RTC_SAV_TRAILER_SIZE]);
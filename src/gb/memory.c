@@ -21,93 +21,257 @@ static const uint8_t DMG_BOOT_ROM[] = {
   0xF5,0x06,0x19,0x78,0x86,0x23,0x05,0x20,0xFB,0x86,0x20,0xFE,0x3E,0x01,0xE0,0x50
 };
 
-static GB_result_t allocate_memory_block(GB_emulator_t *gb, void **ptr, size_t num, size_t size) {
-  GB_result_t result = GB_SUCCESS;
-  *ptr = calloc(num, size);
-  if (!(*ptr)) {
-    GB_memory_free(gb);
-    result = GB_ERROR_OUT_OF_MEMORY;
-  }
+static void bind_arena(GB_emulator_t *gb) {
+  GB_memory_arena_t *arena = gb->memory.arena;
+  gb->memory.io = arena->io;
+  gb->memory.hram = arena->hram;
+  gb->memory.ie = &arena->ie;
+  gb->memory.oam = arena->oam;
+}
+
+static GB_memory_page_t *allocate_page(void) {
+  GB_memory_page_t *page = aligned_alloc(alignof(GB_memory_page_t), sizeof(GB_memory_page_t));
+  if (!page) { return NULL; }
+
+  atomic_init(&page->ref_count, 1);
+
+  return page;
+}
 
-  return result;
+static void release_page(GB_memory_page_t *page) {
+  if (page && atomic_fetch_sub(&page->ref_count, 1) == 1) { free(page); }
 }
 
-static void safe_free(void **ptr) {
-  if (*ptr) {
-    free(*ptr);
-    *ptr = NULL;
+static void set_page(GB_emulator_t *gb, uint8_t index, GB_memory_page_t *page) {
+  gb->memory.pages[index] = page;
+  gb->memory.page_data[index] = page ? page->data : NULL;
+}
+
+static GB_result_t resize_pages(GB_emulator_t *gb, uint8_t page_count) {
+  // Dropped pages are released, new pages are zeroed
+  for (uint8_t index = page_count; index < gb->memory.page_count; index++) {
+    release_page(gb->memory.pages[index]);
+    set_page(gb, index, NULL);
+  }
+  for (uint8_t index = gb->memory.page_count; index < page_count; index++) {
+    GB_memory_page_t *page = allocate_page();
+    if (!page) {
+      gb->memory.page_count = index;
+      return GB_ERROR_OUT_OF_MEMORY;
+    }
+    memset(page->data, 0, GB_MEMORY_PAGE_SIZE);
+    set_page(gb, index, page);
   }
+
+  const uint64_t page_mask = page_count < 64 ? (1ull << page_count) - 1 : ~0ull;
+  gb->memory.shared_pages &= page_mask;
+  gb->memory.dirty_pages &= page_mask;
+  gb->memory.page_count = page_count;
+
+  return GB_SUCCESS;
 }
 
 GB_result_t GB_memory_init(GB_emulator_t *gb) {
   if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
- 
-  // Initialize Boot ROM
-  GB_TRY(allocate_memory_block(gb, (void **)&gb->memory.boot_rom, 256, sizeof(uint8_t)));
-  memcpy(gb->memory.boot_rom, DMG_BOOT_ROM, sizeof(DMG_BOOT_ROM));
 
-  // Initialize VRAM (8KB)
-  GB_TRY(allocate_memory_block(gb, (void **)&gb->memory.vram, 0x2000, sizeof(uint8_t)));
+  // Boot ROM is never written, so it is used in place
+  gb->memory.boot_rom = DMG_BOOT_ROM;
+
+  // I/O registers, HRAM, IE and OAM live in one small private arena
+  gb->memory.arena = aligned_alloc(GB_MEMORY_ARENA_ALIGNMENT, sizeof(GB_memory_arena_t));
+  if (!gb->memory.arena) { return GB_ERROR_OUT_OF_MEMORY; }
+  bind_arena(gb);
+
+  // WRAM and VRAM pages, external RAM is added once the cartridge is known
+  memset(gb->memory.pages, 0, sizeof(gb->memory.pages));
+  memset(gb->memory.page_data, 0, sizeof(gb->memory.page_data));
+  gb->memory.page_count = 0;
+  gb->memory.shared_pages = 0;
+  gb->memory.external_ram_bank_count = 0;
+  gb->memory.external_ram_dirty = false;
+  GB_TRY(resize_pages(gb, GB_MEMORY_PAGE_EXTERNAL_RAM));
+
+  return GB_memory_reset(gb);
+}
+
+GB_result_t GB_memory_reset(GB_emulator_t *gb) {
+  if (!gb)               { return GB_ERROR_INVALID_EMULATOR; }
+  if (!gb->memory.arena) { return GB_ERROR_INVALID_MEMORY_ACCESS; }
 
-  // Initialize WRAM (8KB)
-  GB_TRY(allocate_memory_block(gb, (void **)&gb->memory.wram, 0x2000, sizeof(uint8_t)));
+  memset(gb->memory.arena, 0, sizeof(GB_memory_arena_t));
+  for (uint8_t index = 0; index < gb->memory.page_count; index++) {
+    GB_TRY(GB_memory_unshare_page(gb, index, false));
+    memset(gb->memory.page_data[index], 0, GB_MEMORY_PAGE_SIZE);
+  }
+  gb->memory.dirty_pages = 0;
   //for (int i = 0; i < 0x2000; ++i) {
   //  gb->memory.wram[i] = rand() % 0xFF;
   //}
 
-  // Echo RAM is a mirror of WRAM, so no need to allocated separate memory
-  gb->memory.echo_ram = gb->memory.wram;
-
-  // Initialize OAM (160 bytes)
-  GB_TRY(allocate_memory_block(gb, (void **)&gb->memory.oam, 0xA0, sizeof(uint8_t)));
-
-  // Initialize I/O registers (128 bytes)
-  GB_TRY(allocate_memory_block(gb, (void **)&gb->memory.io, 0x80, sizeof(uint8_t)));
+  // Initialize I/O registers
   gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_KEY1)] = 0xFF;
 
-  // Initialize HRAM (127 bytes)
-  GB_TRY(allocate_memory_block(gb, (void **)&gb->memory.hram, 0x7F, sizeof(uint8_t)));
+  // Initialize HRAM
   gb->memory.hram[0] = 0x01;
 
-  // Initialize the interrupt enable register
-  gb->memory.ie = 0;
- 
-  // Initialize MBC controller
-  gb->memory.mbc.rom_bank = 0;
-  gb->memory.mbc.ram_bank = 0;
-  gb->memory.mbc.mode = 0;
-  gb->memory.mbc.ram_enabled = false;
+  // MBC is selected once a cartridge is attached
+  memset(&gb->memory.mbc, 0, sizeof(GB_mbc_t));
+  gb->memory.mbc.ram_page = GB_MBC_RAM_UNMAPPED;
 
   return GB_SUCCESS;
 }
 
-GB_result_t GB_memory_free(GB_emulator_t *gb) {
+GB_result_t GB_memory_init_external_ram(GB_emulator_t *gb, uint8_t bank_count) {
+  if (!gb)              { return GB_ERROR_INVALID_EMULATOR; }
+  if (bank_count > 16)  { return GB_ERROR_INVALID_ARGUMENT; }
+
+  GB_TRY(resize_pages(gb, GB_MEMORY_PAGE_EXTERNAL_RAM + bank_count * 2));
+  gb->memory.external_ram_bank_count = bank_count;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_memory_fork(GB_emulator_t *child, GB_emulator_t *parent) {
+  if (!child || !parent)     { return GB_ERROR_INVALID_EMULATOR; }
+  if (!parent->memory.arena) { return GB_ERROR_INVALID_MEMORY_ACCESS; }
+
+  GB_memory_arena_t *arena = aligned_alloc(GB_MEMORY_ARENA_ALIGNMENT, sizeof(GB_memory_arena_t));
+  if (!arena) { return GB_ERROR_OUT_OF_MEMORY; }
+
+  // Private arena is copied, pages are shared until either side writes them
+  child->memory = parent->memory;
+  child->memory.arena = arena;
+  memcpy(arena, parent->memory.arena, sizeof(GB_memory_arena_t));
+  bind_arena(child);
+
+  for (uint8_t index = 0; index < parent->memory.page_count; index++) {
+    atomic_fetch_add(&parent->memory.pages[index]->ref_count, 1);
+  }
+  const uint64_t page_mask = parent->memory.page_count < 64 ? (1ull << parent->memory.page_count) - 1 : ~0ull;
+  parent->memory.shared_pages = page_mask;
+  child->memory.shared_pages = page_mask;
+  child->memory.dirty_pages = 0;
+
+  GB_rom_retain(child->memory.rom);
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_memory_share_pages(GB_emulator_t *gb) {
   if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
 
-  gb->memory.mbc.rom_bank = 0;
-  gb->memory.mbc.ram_bank = 0;
-  gb->memory.mbc.mode = 0;
-  gb->memory.mbc.ram_enabled = false;
+  // Owner copies its pages before writing them from now on, so others may take them by reference
+  gb->memory.shared_pages = gb->memory.page_count < 64 ? (1ull << gb->memory.page_count) - 1 : ~0ull;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_memory_unshare_page(GB_emulator_t *gb, uint8_t index, bool keep_contents) {
+  if (!gb)                             { return GB_ERROR_INVALID_EMULATOR; }
+  if (index >= gb->memory.page_count)  { return GB_ERROR_INVALID_ARGUMENT; }
 
-  gb->memory.ie = 0;
-  safe_free((void **)&gb->memory.hram);
-  safe_free((void **)&gb->memory.io);
-  safe_free((void **)&gb->memory.oam);
-  gb->memory.echo_ram = NULL;
-  safe_free((void **)&gb->memory.wram);
+  const uint64_t page_bit = 1ull << index;
+  if (!(gb->memory.shared_pages & page_bit)) { return GB_SUCCESS; }
 
-  for (uint8_t ram_index = 0; ram_index < 16; ram_index++) {
-    safe_free((void **)&gb->memory.external_ram[ram_index]);
+  // Last owner keeps the page, the other side already made its copy
+  GB_memory_page_t *shared_page = gb->memory.pages[index];
+  if (atomic_load(&shared_page->ref_count) > 1) {
+    GB_memory_page_t *page = allocate_page();
+    if (!page) { return GB_ERROR_OUT_OF_MEMORY; }
+    if (keep_contents) { memcpy(page->data, shared_page->data, GB_MEMORY_PAGE_SIZE); }
+    set_page(gb, index, page);
+    release_page(shared_page);
   }
+  gb->memory.shared_pages &= ~page_bit;
 
-  safe_free((void **)&gb->memory.vram);
+  return GB_SUCCESS;
+}
 
-  for (uint16_t rom_index = 0; rom_index < 512; rom_index++) {
-    safe_free((void **)&gb->memory.rom_x[rom_index]);
+GB_result_t GB_memory_restore(GB_emulator_t *gb, const GB_emulator_t *snapshot) {
+  if (!gb || !snapshot)                            { return GB_ERROR_INVALID_EMULATOR; }
+  if (!gb->memory.arena || !snapshot->memory.arena) { return GB_ERROR_INVALID_MEMORY_ACCESS; }
+  if (gb->memory.page_count != snapshot->memory.page_count) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Only pages the snapshot copies before writing can be taken by reference, the others are copied
+  // into pages of gb's own. Those are allocated first, so running out of memory leaves gb as it was
+  for (uint8_t index = 0; index < gb->memory.page_count; index++) {
+    if (gb->memory.pages[index] == snapshot->memory.pages[index]) { continue; }
+    if (!(snapshot->memory.shared_pages & (1ull << index))) { GB_TRY(GB_memory_unshare_page(gb, index, false)); }
   }
 
-  safe_free((void **)&gb->memory.rom_0);
-  safe_free((void **)&gb->memory.boot_rom);
+  memcpy(gb->memory.arena, snapshot->memory.arena, sizeof(GB_memory_arena_t));
+  gb->memory.mbc = snapshot->memory.mbc;
+  if (gb->memory.rom != snapshot->memory.rom) {
+    GB_rom_retain(snapshot->memory.rom);
+    GB_rom_release(gb->memory.rom);
+    gb->memory.rom = snapshot->memory.rom;
+    gb->memory.rom_0 = snapshot->memory.rom_0;
+  }
+
+  // Pages still shared with the snapshot are unchanged, private pages are overwritten in place and
+  // pages shared with anything else start sharing the snapshot's
+  for (uint8_t index = 0; index < gb->memory.page_count; index++) {
+    GB_memory_page_t *page = snapshot->memory.pages[index];
+    if (gb->memory.pages[index] == page) { continue; }
+
+    const uint64_t page_bit = 1ull << index;
+    if (gb->memory.shared_pages & page_bit) {
+      atomic_fetch_add(&page->ref_count, 1);
+      release_page(gb->memory.pages[index]);
+      set_page(gb, index, page);
+    } else {
+      memcpy(gb->memory.page_data[index], page->data, GB_MEMORY_PAGE_SIZE);
+    }
+    if (index >= GB_MEMORY_PAGE_EXTERNAL_RAM) { gb->memory.external_ram_dirty = true; }
+  }
+
+  // Snapshot copies the pages gb took before writing them, so they stay shared on both sides
+  for (uint8_t index = 0; index < gb->memory.page_count; index++) {
+    if (gb->memory.pages[index] == snapshot->memory.pages[index]) { gb->memory.shared_pages |= 1ull << index; }
+  }
+  gb->memory.dirty_pages = gb->memory.page_count < 64 ? (1ull << gb->memory.page_count) - 1 : ~0ull;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_memory_clear_dirty_pages(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  gb->memory.dirty_pages = 0;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_memory_free(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  memset(&gb->memory.mbc, 0, sizeof(GB_mbc_t));
+  gb->memory.mbc.ram_page = GB_MBC_RAM_UNMAPPED;
+
+  // Pages may still be used by forks
+  for (uint8_t index = 0; index < gb->memory.page_count; index++) {
+    release_page(gb->memory.pages[index]);
+    set_page(gb, index, NULL);
+  }
+  gb->memory.page_count = 0;
+  gb->memory.shared_pages = 0;
+  gb->memory.dirty_pages = 0;
+  gb->memory.external_ram_bank_count = 0;
+  gb->memory.external_ram_dirty = false;
+
+  free(gb->memory.arena);
+  gb->memory.arena = NULL;
+  gb->memory.io = NULL;
+  gb->memory.hram = NULL;
+  gb->memory.ie = NULL;
+  gb->memory.oam = NULL;
+
+  // ROM image is shared between emulators
+  gb->memory.rom_0 = NULL;
+  GB_rom_release(gb->memory.rom);
+  gb->memory.rom = NULL;
+
+  gb->memory.boot_rom = NULL;
 
   return GB_SUCCESS;
 }
@@ -126,3 +290,87 @@ GB_result_t GB_memory_read_rom_header(GB_emulator_t *gb, GB_rom_header_t *header
   return GB_SUCCESS;
 }
 
+static uint8_t double_nibble(uint8_t nibble) {
+  // Every bit of the nibble twice, the logo is scaled up 2x horizontally
+  uint8_t value = 0;
+  for (int8_t bit = 3; bit >= 0; bit--) { value = (value << 2) | (((nibble >> bit) & 1) * 0x03); }
+  return value;
+}
+
+GB_result_t GB_memory_skip_boot(GB_emulator_t *gb) {
+  if (!gb)                                  { return GB_ERROR_INVALID_EMULATOR;      }
+  if (!gb->memory.arena || !gb->memory.rom_0) { return GB_ERROR_INVALID_MEMORY_ACCESS; }
+
+  // I/O registers as the boot ROM leaves them, sound is still playing the logo chime
+  static const struct {
+    uint16_t address;
+    uint8_t value;
+  } registers[] = {
+    { GB_HARDWARE_REGISTER_DIV,  0xAB }, { GB_HARDWARE_REGISTER_IF,   0x01 },
+    { GB_HARDWARE_REGISTER_NR11, 0x80 }, { GB_HARDWARE_REGISTER_NR12, 0xF3 },
+    { GB_HARDWARE_REGISTER_NR13, 0xC1 }, { GB_HARDWARE_REGISTER_NR14, 0x87 },
+    { GB_HARDWARE_REGISTER_NR50, 0x77 }, { GB_HARDWARE_REGISTER_NR51, 0xF3 },
+    { GB_HARDWARE_REGISTER_NR52, 0x80 }, { GB_HARDWARE_REGISTER_LCDC, 0x91 },
+    { GB_HARDWARE_REGISTER_STAT, 0x01 }, { GB_HARDWARE_REGISTER_LY,   0x99 },
+    { GB_HARDWARE_REGISTER_BGP,  0xFC }, { GB_HARDWARE_REGISTER_BOOT, 0x01 },
+  };
+  for (uint32_t i = 0; i < sizeof(registers) / sizeof(registers[0]); i++) {
+    gb->memory.io[GB_MEMORY_IO_OFFSET(registers[i].address)] = registers[i].value;
+  }
+  *gb->memory.ie = 0x01;  // Same as the CPU does on the BOOT write
+
+  // Stack bytes of its last calls
+  gb->memory.hram[GB_MEMORY_HRAM_OFFSET(0xFFFA)] = 0x39;
+  gb->memory.hram[GB_MEMORY_HRAM_OFFSET(0xFFFB)] = 0x01;
+  gb->memory.hram[GB_MEMORY_HRAM_OFFSET(0xFFFC)] = 0x2E;
+
+  for (uint8_t page = GB_MEMORY_PAGE_VRAM; page < GB_MEMORY_PAGE_VRAM + 2; page++) {
+    GB_TRY(GB_memory_unshare_page(gb, page, true));
+    gb->memory.dirty_pages |= 1ull << page;
+  }
+
+  // Logo tiles from the cartridge header, every nibble becomes two rows of a tile, odd bytes stay clear
+  uint16_t offset = GB_MEMORY_VRAM_OFFSET(0x8010);
+  for (uint16_t address = 0x0104; address < 0x0134; address++, offset += 8) {
+    const uint8_t high = double_nibble(gb->memory.rom_0[address] >> 4);
+    const uint8_t low = double_nibble(gb->memory.rom_0[address] & 0x0F);
+    GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, offset + 0) = high;
+    GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, offset + 2) = high;
+    GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, offset + 4) = low;
+    GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, offset + 6) = low;
+  }
+
+  // Registered mark tile comes from the boot ROM itself
+  for (uint8_t row = 0; row < 8; row++) {
+    GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, offset + row * 2) = DMG_BOOT_ROM[0xD8 + row];
+  }
+
+  // Tile map, two rows of 12 logo tiles and the mark
+  for (uint8_t tile = 1; tile <= 0x0C; tile++) {
+    GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(0x9903 + tile)) = tile;
+    GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(0x9923 + tile)) = tile + 0x0C;
+  }
+  GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(0x9910)) = 0x19;
+
+  return GB_SUCCESS;
+}
+
+uint8_t GB_memory_peek(GB_emulator_t *gb, uint16_t address) {
+  // Same mapping as a CPU read, but without the PPU and DMA restrictions, the boot ROM overlay or RTC registers
+  const GB_memory_t *memory = &gb->memory;
+  if (address < 0x4000) { return memory->rom_0 ? memory->rom_0[address] : 0xFF; }
+  if (address < 0x8000) { return memory->mbc.rom_x ? memory->mbc.rom_x[address - 0x4000] : 0xFF; }
+  if (address < 0xA000) { return GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(address)); }
+  if (address < 0xC000) {
+    const GB_mbc_t *mbc = &memory->mbc;
+    if (mbc->ram_page == GB_MBC_RAM_UNMAPPED || mbc->ram_page == GB_MBC_RAM_RTC) { return 0xFF; }
+    return GB_MEMORY_PAGED(memory, mbc->ram_page, (address - 0xA000) & mbc->ram_address_mask) | mbc->ram_value_mask;
+  }
+  if (address < 0xE000) { return GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_WRAM, GB_MEMORY_WRAM_OFFSET(address)); }
+  if (address < 0xFE00) { return GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_WRAM, GB_MEMORY_ECHO_OFFSET(address)); }
+  if (address < 0xFEA0) { return memory->oam[GB_MEMORY_OAM_OFFSET(address)]; }
+  if (address < 0xFF00) { return 0x00; }
+  if (address < 0xFF80) { return memory->io[GB_MEMORY_IO_OFFSET(address)]; }
+  if (address < 0xFFFF) { return memory->hram[GB_MEMORY_HRAM_OFFSET(address)]; }
+  return *memory->ie;
+}
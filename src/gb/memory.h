@@ -1,6 +1,9 @@
 #pragma once
 
 #include "defs.h"
+#include "mbc/mbc.h"
+#include <stdalign.h>
+#include <stdatomic.h>
 
 ;
 #pragma pack(push, 1)
@@ -25,29 +28,65 @@ typedef struct {
 
 #pragma pack(pop)
 
+#define GB_MEMORY_ARENA_ALIGNMENT   (64)  // Cache line size
+#define GB_MEMORY_PAGE_SIZE         (0x1000)
+#define GB_MEMORY_PAGE_SHIFT        (12)
+#define GB_MEMORY_PAGE_WRAM         (0)  // 2 pages
+#define GB_MEMORY_PAGE_VRAM         (2)  // 2 pages
+#define GB_MEMORY_PAGE_EXTERNAL_RAM (4)  // 2 pages per bank
+#define GB_MEMORY_MAX_PAGES         (GB_MEMORY_PAGE_EXTERNAL_RAM + 16 * 2)
+
+// Byte of a paged region, offset is relative to the start of the region
+#define GB_MEMORY_PAGED(memory, first_page, offset) \
+  ((memory)->page_data[(first_page) + ((offset) >> GB_MEMORY_PAGE_SHIFT)][(offset) & (GB_MEMORY_PAGE_SIZE - 1)])
+
+typedef struct {
+  atomic_uint ref_count;  // Emulators sharing the page, it's copied before a write while shared
+  alignas(GB_MEMORY_ARENA_ALIGNMENT) uint8_t data[GB_MEMORY_PAGE_SIZE];
+} GB_memory_page_t;
+
 typedef struct {
-  uint16_t rom_bank;     // Active ROM bank number
-  uint8_t ram_bank;     // Active RAM bank number (if supported)
-  uint8_t mode;         // Operational mode (used by MBC1 to switch between ROM and RAM)
-  bool ram_enabled;  // Flag to enable/disable access to the RAM
-} GB_mbc_t;
+  /* $FF00:$FF7F */ uint8_t io[0x80];    // Hot registers and HRAM share the first cache lines
+  /* $FF80:$FFFE */ uint8_t hram[0x7F];
+  /* $FFFF:$FFFF */ uint8_t ie;
+  /* $FE00:$FE9F */ uint8_t oam[0xA0];
+                    uint8_t reserved[0x60];
+} GB_memory_arena_t;  // Regions written directly by the PPU and timer, never shared
 
 typedef struct {
-  /* $0000:$0100 */ uint8_t *boot_rom;
-  /* $0000:$3FFF */ uint8_t *rom_0;
-  /* $4000:$7FFF */ uint8_t *rom_x[512];
-  /* $8000:$9FFF */ uint8_t *vram;
-  /* $A000:$BFFF */ uint8_t *external_ram[16];
-  /* $C000:$CFFF */ uint8_t *wram;
-  /* $E000:$FDFF */ uint8_t *echo_ram;
+  /* $0000:$0100 */ const uint8_t *boot_rom;
+  /* $0000:$3FFF */ const uint8_t *rom_0;  // Bank mapped by the MBC, usually bank 0
+  /* $4000:$7FFF */ GB_rom_t *rom;  // Shared ROM image, the switchable bank is mbc.rom_x
   /* $FE00:$FE9F */ uint8_t *oam;
   /* $FF00:$FF7F */ uint8_t *io;
   /* $FF80:$FFFE */ uint8_t *hram;
-  /* $FFFF:$FFFF */ uint8_t ie;
+  /* $FFFF:$FFFF */ uint8_t *ie;
                     GB_mbc_t mbc;
+                    GB_memory_arena_t *arena;
+                    uint8_t external_ram_bank_count;
+                    bool external_ram_dirty;  // External RAM changed since the last battery flush
+
+  /* WRAM, VRAM and external RAM live in refcounted pages, shared copy-on-write between forks */
+                    GB_memory_page_t *pages[GB_MEMORY_MAX_PAGES];
+                    uint8_t *page_data[GB_MEMORY_MAX_PAGES];
+                    uint8_t page_count;
+                    uint64_t shared_pages;  // Pages that must be copied before they are written
+                    uint64_t dirty_pages;   // Pages written since the fork or GB_memory_clear_dirty_pages
 } GB_memory_t;
 
 GB_result_t GB_memory_init(GB_emulator_t *gb);
 GB_result_t GB_memory_free(GB_emulator_t *gb);
+GB_result_t GB_memory_reset(GB_emulator_t *gb);
+GB_result_t GB_memory_init_external_ram(GB_emulator_t *gb, uint8_t bank_count);
+GB_result_t GB_memory_fork(GB_emulator_t *child, GB_emulator_t *parent);
+GB_result_t GB_memory_share_pages(GB_emulator_t *gb);
+GB_result_t GB_memory_unshare_page(GB_emulator_t *gb, uint8_t page, bool keep_contents);
+GB_result_t GB_memory_restore(GB_emulator_t *gb, const GB_emulator_t *snapshot);
+GB_result_t GB_memory_clear_dirty_pages(GB_emulator_t *gb);
 GB_result_t GB_memory_read_rom_header(GB_emulator_t *gb, GB_rom_header_t *header);
 
+// Registers, HRAM and VRAM as the boot ROM leaves them for the attached cartridge, see GB_emulator_skip_boot
+GB_result_t GB_memory_skip_boot(GB_emulator_t *gb);
+
+// Byte at a CPU address as stored, I/O registers included, without side effects
+uint8_t GB_memory_peek(GB_emulator_t *gb, uint16_t address);
@@ -0,0 +1,181 @@
+#include "observation.h"
+#include <stdlib.h>
+
+// Loops run branch free over whole screen rows, so the compiler vectorises them
+
+static GB_result_t build_axis(uint16_t offset, uint16_t source_size, uint16_t output_size, bool nearest,
+                              GB_observation_tap_t **out_taps, uint16_t **out_weights) {
+  // Output pixel o covers [o * source, (o + 1) * source) and source pixel s covers
+  // [s * output, (s + 1) * output), their overlap is the weight of s
+  const uint32_t max_count = nearest ? 1 : source_size / output_size + 2;
+  GB_observation_tap_t *taps = calloc(output_size, sizeof(GB_observation_tap_t));
+  uint16_t *weights = calloc((size_t)output_size * max_count, sizeof(uint16_t));
+  if (!taps || !weights) {
+    free(taps);
+    free(weights);
+    return GB_ERROR_OUT_OF_MEMORY;
+  }
+
+  uint32_t weight_count = 0;
+  for (uint32_t o = 0; o < output_size; o++) {
+    GB_observation_tap_t *tap = &taps[o];
+    tap->weights = weight_count;
+    if (nearest) {
+      tap->first = offset + (2 * o + 1) * source_size / (2 * output_size);
+      tap->count = 1;
+      weights[weight_count++] = source_size;
+      continue;
+    }
+
+    const uint32_t low = o * source_size;
+    const uint32_t high = (o + 1) * source_size;
+    const uint32_t first = low / output_size;
+    const uint32_t last = (high - 1) / output_size;
+    tap->first = offset + first;
+    tap->count = last - first + 1;
+    for (uint32_t s = first; s <= last; s++) {
+      const uint32_t start = s * output_size > low ? s * output_size : low;
+      const uint32_t end = (s + 1) * output_size < high ? (s + 1) * output_size : high;
+      weights[weight_count++] = end - start;
+    }
+  }
+
+  *out_taps = taps;
+  *out_weights = weights;
+
+  return GB_SUCCESS;
+}
+
+static void gray_row(const uint8_t *pixels, const uint8_t *previous, uint32_t weight, uint32_t row[GB_SCREEN_WIDTH]) {
+  // Whole screen rows are summed, a fixed trip count lets even cheap vectorisation kick in
+  if (previous) {
+    for (uint32_t x = 0; x < GB_SCREEN_WIDTH; x++) {
+      const uint8_t shade = (pixels[x] & 0x03) > (previous[x] & 0x03) ? (pixels[x] & 0x03) : (previous[x] & 0x03);
+      row[x] += weight * (255 - shade * 85);
+    }
+  } else {
+    for (uint32_t x = 0; x < GB_SCREEN_WIDTH; x++) { row[x] += weight * (255 - (pixels[x] & 0x03) * 85); }
+  }
+}
+
+static void write_unscaled(const GB_observation_t *observation, const uint8_t *framebuffer, const uint8_t *previous, uint8_t *out) {
+  // Whole rows are converted and the crop copied out, as with the sums below
+  const GB_observation_config_t *config = &observation->config;
+  const bool gray = config->color == GB_OBSERVATION_GRAYSCALE;
+  uint8_t line[GB_SCREEN_WIDTH];
+  for (uint32_t y = 0; y < config->height; y++) {
+    const size_t source = (size_t)(config->crop_y + y) * GB_SCREEN_WIDTH;
+    const uint8_t *pixels = framebuffer + source;
+    if (previous) {
+      const uint8_t *previous_pixels = previous + source;
+      for (uint32_t x = 0; x < GB_SCREEN_WIDTH; x++) {
+        line[x] = (pixels[x] & 0x03) > (previous_pixels[x] & 0x03) ? (pixels[x] & 0x03) : (previous_pixels[x] & 0x03);
+      }
+    } else {
+      for (uint32_t x = 0; x < GB_SCREEN_WIDTH; x++) { line[x] = pixels[x] & 0x03; }
+    }
+    if (gray) {
+      for (uint32_t x = 0; x < GB_SCREEN_WIDTH; x++) { line[x] = 255 - line[x] * 85; }
+    }
+    memcpy(out + (size_t)y * config->width, line + config->crop_x, config->width);
+  }
+}
+
+static void write_nearest(const GB_observation_t *observation, const uint8_t *framebuffer, const uint8_t *previous, uint8_t *out) {
+  const GB_observation_config_t *config = &observation->config;
+  for (uint32_t y = 0; y < config->height; y++) {
+    const size_t source = (size_t)observation->y_taps[y].first * GB_SCREEN_WIDTH;
+    const uint8_t *pixels = framebuffer + source;
+    const uint8_t *previous_pixels = previous ? previous + source : pixels;
+    uint8_t *out_row = out + (size_t)y * config->width;
+    for (uint32_t x = 0; x < config->width; x++) {
+      const uint16_t first = observation->x_taps[x].first;
+      const uint8_t shade = pixels[first] & 0x03;
+      const uint8_t previous_shade = previous_pixels[first] & 0x03;
+      out_row[x] = shade > previous_shade ? shade : previous_shade;
+    }
+  }
+}
+
+static void write_area(const GB_observation_t *observation, const uint8_t *framebuffer, const uint8_t *previous, uint8_t *out) {
+  // Rows of the crop are summed with their vertical weights first, then every column with its horizontal ones
+  const GB_observation_config_t *config = &observation->config;
+  // Division by the covered area is a multiplication, exact while sums stay below 2^25
+  const uint32_t scale = (uint32_t)config->crop_width * config->crop_height;
+  const uint64_t reciprocal = ((1ull << 40) + scale - 1) / scale;
+  uint32_t row[GB_SCREEN_WIDTH];
+  for (uint32_t y = 0; y < config->height; y++) {
+    const GB_observation_tap_t *y_tap = &observation->y_taps[y];
+    memset(row, 0, sizeof(row));
+    for (uint32_t t = 0; t < y_tap->count; t++) {
+      const size_t source = (size_t)(y_tap->first + t) * GB_SCREEN_WIDTH;
+      gray_row(framebuffer + source, previous ? previous + source : NULL, observation->y_weights[y_tap->weights + t], row);
+    }
+
+    uint8_t *out_row = out + (size_t)y * config->width;
+    for (uint32_t x = 0; x < config->width; x++) {
+      const GB_observation_tap_t *x_tap = &observation->x_taps[x];
+      const uint32_t *sources = row + x_tap->first;
+      const uint16_t *weights = observation->x_weights + x_tap->weights;
+      uint32_t sum = 0;
+      for (uint32_t t = 0; t < x_tap->count; t++) { sum += weights[t] * sources[t]; }
+      out_row[x] = (uint8_t)(((sum + scale / 2) * reciprocal) >> 40);
+    }
+  }
+}
+
+GB_result_t GB_observation_init(GB_observation_t *observation, const GB_observation_config_t *config) {
+  if (!observation) { return GB_ERROR_INVALID_ARGUMENT; }
+  memset(observation, 0, sizeof(GB_observation_t));
+  if (config) { observation->config = *config; }
+
+  GB_observation_config_t *resolved = &observation->config;
+  if (resolved->crop_width == 0)  { resolved->crop_width = GB_SCREEN_WIDTH - (resolved->crop_x < GB_SCREEN_WIDTH ? resolved->crop_x : GB_SCREEN_WIDTH); }
+  if (resolved->crop_height == 0) { resolved->crop_height = GB_SCREEN_HEIGHT - (resolved->crop_y < GB_SCREEN_HEIGHT ? resolved->crop_y : GB_SCREEN_HEIGHT); }
+  if (resolved->width == 0)       { resolved->width = resolved->crop_width; }
+  if (resolved->height == 0)      { resolved->height = resolved->crop_height; }
+  if (resolved->color > GB_OBSERVATION_GRAYSCALE ||
+      resolved->crop_width == 0 || resolved->crop_x + resolved->crop_width > GB_SCREEN_WIDTH ||
+      resolved->crop_height == 0 || resolved->crop_y + resolved->crop_height > GB_SCREEN_HEIGHT ||
+      resolved->width > resolved->crop_width || resolved->height > resolved->crop_height) {
+    return GB_ERROR_INVALID_ARGUMENT;
+  }
+  observation->size = (size_t)resolved->width * resolved->height;
+
+  const bool nearest = resolved->color == GB_OBSERVATION_SHADES;
+  GB_result_t result = build_axis(resolved->crop_x, resolved->crop_width, resolved->width, nearest, &observation->x_taps, &observation->x_weights);
+  if (result == GB_SUCCESS) {
+    result = build_axis(resolved->crop_y, resolved->crop_height, resolved->height, nearest, &observation->y_taps, &observation->y_weights);
+  }
+  if (GB_FAILED(result)) {
+    GB_observation_free(observation);
+    return result;
+  }
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_observation_free(GB_observation_t *observation) {
+  if (!observation) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  free(observation->x_taps);
+  free(observation->y_taps);
+  free(observation->x_weights);
+  free(observation->y_weights);
+  memset(observation, 0, sizeof(GB_observation_t));
+
+  return GB_SUCCESS;
+}
+
+void GB_observation_write(const GB_observation_t *observation, const uint8_t *framebuffer, const uint8_t *previous, uint8_t *out) {
+  const GB_observation_config_t *config = &observation->config;
+  if (!config->max_pool) { previous = NULL; }
+
+  if (config->width == config->crop_width && config->height == config->crop_height) {
+    write_unscaled(observation, framebuffer, previous, out);
+  } else if (config->color == GB_OBSERVATION_SHADES) {
+    write_nearest(observation, framebuffer, previous, out);
+  } else {
+    write_area(observation, framebuffer, previous, out);
+  }
+}
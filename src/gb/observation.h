@@ -0,0 +1,40 @@
+#pragma once
+
+#include "defs.h"
+
+typedef enum {
+  GB_OBSERVATION_SHADES = 0,  // Shade index 0-3 per pixel as in the framebuffer, resized by nearest neighbour
+  GB_OBSERVATION_GRAYSCALE    // 255 for white down to 0 for black, resized by area averaging
+} GB_observation_color_t;
+
+typedef struct {
+  uint16_t crop_x;
+  uint16_t crop_y;
+  uint16_t crop_width;        // 0 crops nothing on that axis
+  uint16_t crop_height;
+  uint16_t width;             // Output size, 0 keeps the crop size, larger than the crop isn't supported
+  uint16_t height;
+  bool max_pool;              // Every pixel is the darker of the last two frames, which hides sprite flicker
+  GB_observation_color_t color;
+} GB_observation_config_t;
+
+typedef struct {
+  uint16_t first;             // First source pixel
+  uint16_t count;             // Source pixels covered
+  uint32_t weights;           // Offset of the first weight in the axis weights
+} GB_observation_tap_t;
+
+typedef struct {
+  GB_observation_config_t config;   // Crop and size resolved against the screen
+  size_t size;                      // Bytes of one observation, width * height
+  GB_observation_tap_t *x_taps;     // Source pixels of every output column and row
+  GB_observation_tap_t *y_taps;
+  uint16_t *x_weights;              // Overlap with the output pixel, a column sums to crop_width
+  uint16_t *y_weights;
+} GB_observation_t;
+
+GB_result_t GB_observation_init(GB_observation_t *observation, const GB_observation_config_t *config);
+GB_result_t GB_observation_free(GB_observation_t *observation);
+
+// Writes one observation of the framebuffer, previous is the frame before it and only read with max_pool
+void GB_observation_write(const GB_observation_t *observation, const uint8_t *framebuffer, const uint8_t *previous, uint8_t *out);
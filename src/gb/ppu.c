@@ -1,6 +1,9 @@
 #include "ppu.h"
 #include "gb.h"  // IWYU pragma: keep
 
+// Fewer pending lines are rendered on the emulation thread
+#define GB_PPU_PARALLEL_MIN_LINES (16)
+
 static void reset(GB_emulator_t *gb) {
   // General
   memset(gb->ppu.framebuffer, 0, GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT * sizeof(uint8_t));
@@ -20,6 +23,159 @@ static void reset(GB_emulator_t *gb) {
   // BG FIFO
   memset(gb->ppu.bg_fifo.pixels, 0, 8 * sizeof(uint8_t));
   gb->ppu.bg_fifo.count = 0;
+
+  // Line renderer
+  gb->ppu.first_pending_line = 0;
+  gb->ppu.pending_line_count = 0;
+  gb->ppu.render_pool = NULL;
+  gb->ppu.render_skip = false;
+  gb->ppu.frame_ready = false;
+}
+
+static uint16_t tile_data_offset(uint8_t lcdc, uint8_t tile_index) {
+  if (lcdc & GB_PPU_LCDC_BG_WINDOW_TILES) {
+    return GB_MEMORY_VRAM_OFFSET(0x8000 + tile_index * 16);
+  }
+
+  const int8_t signed_tile_index = (int8_t)tile_index;
+  return signed_tile_index >= 0 ? GB_MEMORY_VRAM_OFFSET(0x9000 + signed_tile_index * 16)
+                                : GB_MEMORY_VRAM_OFFSET(0x8800 + (signed_tile_index + 128) * 16);
+}
+
+typedef struct {
+  const GB_oam_sprite_t *sprite;
+  int16_t x;                  // Screen column of the left edge
+  uint8_t low;
+  uint8_t high;
+} sprite_row_t;               // Row of a sprite drawn on the current line
+
+static bool fetch_sprite_row(const GB_memory_t *memory, const GB_oam_sprite_t *sprite, uint8_t lcdc, uint8_t ly, sprite_row_t *row) {
+  const uint8_t sprite_height = 8 << ((lcdc & GB_PPU_LCDC_OBJ_SIZE) != 0);
+  const uint8_t tile_mask = (sprite_height == 16) ? 0xFE : 0xFF;
+  const int16_t sprite_y = sprite->y - 16;
+  if (sprite_y < 0 || sprite_y >= GB_SCREEN_HEIGHT) { return false; }
+
+  int8_t rel_y = ly - sprite_y;
+  if (rel_y < 0 || rel_y >= sprite_height) { return false; }
+  if (sprite->flags & GB_PPU_OAM_FLAG_Y_FLIP) { rel_y = sprite_height - 1 - rel_y; }
+
+  const uint16_t addr = (sprite->tile_index & tile_mask) * 16 + rel_y * 2;
+  row->sprite = sprite;
+  row->x = sprite->x - 8;
+  row->low = GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_VRAM, addr);
+  row->high = GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_VRAM, addr + 1);
+
+  return true;
+}
+
+// Shared by the pixel FIFO and the line renderer, so both draw the same frame
+static uint8_t mix_pixel(const sprite_row_t *rows, uint8_t row_count, uint8_t x,
+                         uint8_t bg_color_index, uint8_t bg_color, uint8_t obp0, uint8_t obp1) {
+  // First opaque sprite in OAM scan order that isn't behind the background wins
+  for (uint8_t i = 0; i < row_count; i++) {
+    const int16_t rel_x = x - rows[i].x;
+    if (rel_x < 0 || rel_x >= 8) { continue; }
+
+    const uint8_t flags = rows[i].sprite->flags;
+    const uint8_t bit = (flags & GB_PPU_OAM_FLAG_X_FLIP) ? rel_x : (7 - rel_x);
+    const uint8_t pixel = ((rows[i].high >> bit) & 1) << 1 | ((rows[i].low >> bit) & 1);
+    if (pixel && (!(flags & GB_PPU_OAM_FLAG_PRIORITY) || bg_color_index == 0)) {
+      const uint8_t palette = (flags & GB_PPU_OAM_FLAG_PALLETE) ? obp1 : obp0;
+      return (palette >> (pixel * 2)) & 0x03;
+    }
+  }
+
+  return bg_color;
+}
+
+static void render_line(GB_emulator_t *gb, const GB_ppu_line_t *line, uint8_t ly) {
+  const GB_memory_t *memory = &gb->memory;
+  uint8_t *pixels = &gb->ppu.framebuffer[ly * GB_SCREEN_WIDTH];
+  uint8_t bg_color_indices[GB_SCREEN_WIDTH];
+
+  // Step 1 - background and window
+  const uint8_t wx_position = line->wx < 7 ? 0 : (line->wx - 7);
+  for (uint8_t x = 0; x < GB_SCREEN_WIDTH; x++) {
+    uint8_t bg_color_index;
+    if (line->lcdc & GB_PPU_LCDC_BG_WINDOW_ENABLE) {
+      uint16_t base_addr;
+      uint8_t tile_x, tile_y;
+      if (line->window_entered && x >= wx_position) {
+        base_addr = (line->lcdc & GB_PPU_LCDC_WINDOW_TILE_MAP) ? 0x9C00 : 0x9800;
+        tile_x = x - wx_position;
+        tile_y = line->window_line;
+      } else {
+        base_addr = (line->lcdc & GB_PPU_LCDC_BG_TILE_MAP) ? 0x9C00 : 0x9800;
+        tile_x = x + line->scx;
+        tile_y = ly + line->scy;
+      }
+      const uint8_t tile_index = GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(base_addr + (tile_y / 8) * 32 + (tile_x / 8)));
+      const uint16_t tile_addr = tile_data_offset(line->lcdc, tile_index) + (tile_y % 8) * 2;
+      const uint8_t bit = 7 - (tile_x % 8);
+      const uint8_t low = GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_VRAM, tile_addr);
+      const uint8_t high = GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_VRAM, tile_addr + 1);
+      bg_color_index = (((high >> bit) & 0x01) << 1) | ((low >> bit) & 0x01);
+    } else {
+      // Same as the pixel fetcher, which pushes already mapped color into the FIFO
+      bg_color_index = line->bgp & 0x03;
+    }
+    bg_color_indices[x] = bg_color_index;
+    pixels[x] = (line->bgp >> (bg_color_index * 2)) & 0x03;
+  }
+
+  // Step 2 - sprites, sorted by X in OAM scan
+  if (!(line->lcdc & GB_PPU_LCDC_OBJ_ENABLE)) { return; }
+
+  sprite_row_t rows[GB_MAX_OAM_SPRITES_PER_LINE];
+  uint8_t row_count = 0;
+  for (uint8_t i = 0; i < line->active_sprite_count; i++) {
+    const GB_oam_sprite_t *sprite = (const GB_oam_sprite_t *)&gb->memory.oam[line->active_sprite_indices[i] * sizeof(GB_oam_sprite_t)];
+    if (fetch_sprite_row(memory, sprite, line->lcdc, ly, &rows[row_count])) { row_count++; }
+  }
+  if (row_count == 0) { return; }
+
+  for (uint8_t x = 0; x < GB_SCREEN_WIDTH; x++) {
+    pixels[x] = mix_pixel(rows, row_count, x, bg_color_indices[x], pixels[x], line->obp0, line->obp1);
+  }
+}
+
+static void render_band(void *context, uint32_t index) {
+  GB_emulator_t *gb = context;
+  const uint32_t line_count = gb->ppu.pending_line_count;
+  const uint32_t band_count = gb->ppu.render_pool->thread_count + 1;
+  const uint32_t first_line = gb->ppu.first_pending_line + (line_count * index) / band_count;
+  const uint32_t last_line = gb->ppu.first_pending_line + (line_count * (index + 1)) / band_count;
+  for (uint32_t ly = first_line; ly < last_line; ly++) {
+    render_line(gb, &gb->ppu.lines[ly], ly);
+  }
+}
+
+static GB_result_t latch_line(GB_emulator_t *gb, uint8_t ly) {
+  if (ly >= GB_SCREEN_HEIGHT) { return GB_SUCCESS; }
+
+  // Pending lines are always contiguous
+  if (gb->ppu.pending_line_count > 0 &&
+      ly != gb->ppu.first_pending_line + gb->ppu.pending_line_count) {
+    GB_TRY(GB_ppu_flush(gb));
+  }
+
+  GB_ppu_line_t *line = &gb->ppu.lines[ly];
+  line->lcdc = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_LCDC)];
+  line->scx = gb->ppu.pixel_fetcher.scx;
+  line->scy = gb->ppu.pixel_fetcher.scy;
+  line->bgp = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_BGP)];
+  line->obp0 = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_OBP0)];
+  line->obp1 = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_OBP1)];
+  line->wx = gb->ppu.pixel_fetcher.wx;
+  line->window_line = gb->ppu.pixel_fetcher.window_line;
+  line->window_entered = gb->ppu.pixel_fetcher.window_entered;
+  memcpy(line->active_sprite_indices, gb->ppu.oam_scanline.active_sprite_indices, GB_MAX_OAM_SPRITES_PER_LINE * sizeof(uint8_t));
+  line->active_sprite_count = gb->ppu.oam_scanline.active_sprite_count;
+
+  if (gb->ppu.pending_line_count == 0) { gb->ppu.first_pending_line = ly; }
+  gb->ppu.pending_line_count++;
+
+  return GB_SUCCESS;
 }
 
 static GB_result_t set_ppu_mode(GB_emulator_t *gb, uint8_t new_mode) {
@@ -69,8 +225,10 @@ static GB_result_t handle_mode_hblank(GB_emulator_t *gb) {
     GB_TRY(lyc_cmp(gb));
 
     if (gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_LY)] >= GB_SCREEN_HEIGHT) {
+      GB_TRY(GB_ppu_flush(gb));
       GB_TRY(GB_interrupt_request(gb, GB_INTERRUPT_VBLANK));
       set_ppu_mode(gb, GB_PPU_MODE_VBLANK);
+      gb->ppu.frame_ready = true;
     } else {
       // Reset OAM scanline buffer
       gb->ppu.oam_scanline.active_sprite_count = 0;
@@ -109,6 +267,9 @@ static GB_result_t handle_mode_vblank(GB_emulator_t *gb) {
 }
 
 static GB_result_t handle_mode_oam(GB_emulator_t *gb) {
+  // Sprites are scanned from the part of OAM a running DMA has already written
+  if (gb->dma.active) { GB_TRY(GB_dma_sync(gb)); }
+
   const uint8_t lcdc = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_LCDC)]; 
   if (lcdc & GB_PPU_LCDC_OBJ_ENABLE) {
     const uint8_t ly = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_LY)];
@@ -179,6 +340,27 @@ static GB_result_t handle_mode_oam(GB_emulator_t *gb) {
   return GB_SUCCESS;
 }
 
+static uint8_t draw_pixel(GB_emulator_t *gb, uint8_t lcdc, uint8_t ly, uint8_t bgp) {
+  const uint8_t bg_color_index = gb->ppu.bg_fifo.pixels[0];
+  const uint8_t bg_color = (bgp >> (bg_color_index * 2)) & 0x03;
+  if (!(lcdc & GB_PPU_LCDC_OBJ_ENABLE)) { return bg_color; }
+
+  // Only sprites covering the pixel are fetched, each pixel sees VRAM and OAM as they are now
+  const uint8_t x = gb->ppu.pixel_fetcher.x;
+  sprite_row_t rows[GB_MAX_OAM_SPRITES_PER_LINE];
+  uint8_t row_count = 0;
+  for (uint8_t i = 0; i < gb->ppu.oam_scanline.active_sprite_count; i++) {
+    const GB_oam_sprite_t *sprite = (const GB_oam_sprite_t *)&gb->memory.oam[gb->ppu.oam_scanline.active_sprite_indices[i] * sizeof(GB_oam_sprite_t)];
+    if (x + 8 < sprite->x || x >= sprite->x) { continue; }
+    if (fetch_sprite_row(&gb->memory, sprite, lcdc, ly, &rows[row_count])) { row_count++; }
+  }
+
+  return mix_pixel(rows, row_count, x,
+                   bg_color_index, bg_color,
+                   gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_OBP0)],
+                   gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_OBP1)]);
+}
+
 static GB_result_t handle_mode_drawing(GB_emulator_t *gb) {
   const uint8_t lcdc = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_LCDC)];
   const uint8_t ly = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_LY)];
@@ -220,7 +402,7 @@ static GB_result_t handle_mode_drawing(GB_emulator_t *gb) {
             tile_y = (ly + gb->ppu.pixel_fetcher.scy) % 256;
           }
           const uint16_t tile_addr = base_addr + (tile_y / 8) * 32 + (tile_x / 8);
-          gb->ppu.pixel_fetcher.tile_index = gb->memory.vram[GB_MEMORY_VRAM_OFFSET(tile_addr)];
+          gb->ppu.pixel_fetcher.tile_index = GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(tile_addr));
           gb->ppu.pixel_fetcher.step = GB_PPU_PIXEL_FETCHER_STEP_DATA_LOW;
         } else {
           const uint8_t bg_color = (bgp >> 0) & 0x03;
@@ -248,10 +430,10 @@ static GB_result_t handle_mode_drawing(GB_emulator_t *gb) {
                                                                          : (ly + gb->ppu.pixel_fetcher.scy);
           tile_addr += (tile_line % 8) * 2;
           if (gb->ppu.pixel_fetcher.step == GB_PPU_PIXEL_FETCHER_STEP_DATA_LOW) {
-            gb->ppu.pixel_fetcher.tile_low = gb->memory.vram[GB_MEMORY_VRAM_OFFSET(tile_addr)];
+            gb->ppu.pixel_fetcher.tile_low = GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(tile_addr));
             gb->ppu.pixel_fetcher.step = GB_PPU_PIXEL_FETCHER_STEP_DATA_HIGH;
           } else {
-            gb->ppu.pixel_fetcher.tile_high = gb->memory.vram[GB_MEMORY_VRAM_OFFSET(tile_addr + 1)];
+            gb->ppu.pixel_fetcher.tile_high = GB_MEMORY_PAGED(&gb->memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(tile_addr + 1));
             gb->ppu.pixel_fetcher.step = GB_PPU_PIXEL_FETCHER_STEP_SLEEP;
           }
         }
@@ -287,46 +469,10 @@ static GB_result_t handle_mode_drawing(GB_emulator_t *gb) {
   }
 
   if (gb->ppu.bg_fifo.count > 0) {
-    const uint8_t bg_color_index = gb->ppu.bg_fifo.pixels[0];
-    const uint8_t bg_color = (bgp >> (bg_color_index * 2)) & 0x03;
-    uint8_t final_color = bg_color;
-
-    // Sprites enabled
-    if (lcdc & GB_PPU_LCDC_OBJ_ENABLE) {
-      const uint8_t obp0 = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_OBP0)];
-      const uint8_t obp1 = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_OBP1)];
-      const uint8_t sprite_height = 8 << ((lcdc & GB_PPU_LCDC_OBJ_SIZE) != 0);
-      const uint8_t tile_mask = (sprite_height == 16) ? 0xFE : 0xFF;
-      for (int8_t i = 0; i < gb->ppu.oam_scanline.active_sprite_count; i++) {
-        GB_oam_sprite_t *sprite = (GB_oam_sprite_t *)&gb->memory.oam[gb->ppu.oam_scanline.active_sprite_indices[i] * sizeof(GB_oam_sprite_t)];
-        const int16_t sprite_x = sprite->x - 8;
-        const int16_t sprite_y = sprite->y - 16;
-
-        if (sprite_y < 0 || sprite_y >= GB_SCREEN_HEIGHT) { continue; }
-        if (gb->ppu.pixel_fetcher.x < sprite_x || gb->ppu.pixel_fetcher.x > (sprite_x + 8)) { continue; }
-
-        int8_t rel_y = ly - (sprite->y - 16);
-        if (rel_y < 0 || rel_y >= sprite_height) { continue; }
-        if (sprite->flags & GB_PPU_OAM_FLAG_Y_FLIP) { rel_y = sprite_height - 1 - rel_y; }
-
-        uint8_t tile = sprite->tile_index & tile_mask;
-        const uint16_t addr = tile * 16 + rel_y * 2;
-        const uint8_t low = gb->memory.vram[addr];
-        const uint8_t high = gb->memory.vram[addr + 1];
-        const uint8_t bit = (sprite->flags & GB_PPU_OAM_FLAG_X_FLIP) ? (gb->ppu.pixel_fetcher.x - sprite_x)
-                                                                     : (7 - (gb->ppu.pixel_fetcher.x - sprite_x));
-        const uint8_t pixel = ((high >> bit) & 1) << 1 | ((low >> bit) & 1);
-        if (pixel) {
-          if (!(sprite->flags & GB_PPU_OAM_FLAG_PRIORITY) || bg_color_index == 0) {
-            const uint8_t palette = (sprite->flags & GB_PPU_OAM_FLAG_PALLETE) ? obp1 : obp0;
-            final_color = (palette >> (pixel * 2)) & 0x03;
-            break;
-          }
-        }
-      }
+    // Line renderer rasterizes the whole line once the drawing is done
+    if (!gb->ppu.render_pool && !gb->ppu.render_skip) {
+      gb->ppu.framebuffer[ly * GB_SCREEN_WIDTH + gb->ppu.pixel_fetcher.x] = draw_pixel(gb, lcdc, ly, bgp);
     }
-
-    gb->ppu.framebuffer[ly * GB_SCREEN_WIDTH + gb->ppu.pixel_fetcher.x] = final_color;
     memmove(&gb->ppu.bg_fifo.pixels[0], &gb->ppu.bg_fifo.pixels[1], gb->ppu.bg_fifo.count - 1);
     gb->ppu.bg_fifo.count--;
 
@@ -336,6 +482,7 @@ static GB_result_t handle_mode_drawing(GB_emulator_t *gb) {
   gb->ppu.cycles++;
 
   if (gb->ppu.pixel_fetcher.x >= GB_SCREEN_WIDTH) {
+    if (gb->ppu.render_pool && !gb->ppu.render_skip) { GB_TRY(latch_line(gb, ly)); }
     set_ppu_mode(gb, GB_PPU_MODE_HBLANK);
   }
 
@@ -362,7 +509,7 @@ GB_result_t GB_ppu_free(GB_emulator_t *gb) {
 GB_result_t GB_ppu_tick(GB_emulator_t *gb) {
   if (!gb)             { return GB_ERROR_INVALID_EMULATOR; }
   if (!gb->memory.io   ||
-      !gb->memory.vram ||
+      !gb->memory.page_data[GB_MEMORY_PAGE_VRAM] ||
       !gb->memory.oam) { return GB_ERROR_INVALID_ARGUMENT; }
 
   // LCDC enabled?
@@ -390,3 +537,63 @@ GB_result_t GB_ppu_tick(GB_emulator_t *gb) {
   return GB_SUCCESS;
 }
 
+
+GB_result_t GB_ppu_flush(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+  if (gb->ppu.pending_line_count == 0) { return GB_SUCCESS; }
+
+  GB_thread_pool_t *pool = gb->ppu.render_pool;
+  if (pool && pool->thread_count > 0 && gb->ppu.pending_line_count >= GB_PPU_PARALLEL_MIN_LINES) {
+    GB_TRY(GB_thread_pool_run(pool, render_band, gb, pool->thread_count + 1));
+  } else {
+    for (uint8_t i = 0; i < gb->ppu.pending_line_count; i++) {
+      const uint8_t ly = gb->ppu.first_pending_line + i;
+      render_line(gb, &gb->ppu.lines[ly], ly);
+    }
+  }
+  gb->ppu.pending_line_count = 0;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_ppu_set_render_pool(GB_emulator_t *gb, GB_thread_pool_t *pool) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  GB_TRY(GB_ppu_flush(gb));
+  gb->ppu.render_pool = pool;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_ppu_set_render_skip(GB_emulator_t *gb, bool skip) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  gb->ppu.render_skip = skip;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_ppu_skip_boot(GB_emulator_t *gb) {
+  if (!gb)            { return GB_ERROR_INVALID_EMULATOR; }
+  if (!gb->memory.io) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Boot ROM hands over in the last VBlank line, after a frame showing the logo
+  memset(&gb->ppu.pixel_fetcher, 0, sizeof(GB_ppu_pixel_fetcher_t));
+  gb->ppu.cycles = 426;
+  gb->ppu.pixel_fetcher.step = GB_PPU_PIXEL_FETCHER_STEP_SLEEP;
+  gb->ppu.pixel_fetcher.next_step_cycle = 206;
+  gb->ppu.pixel_fetcher.fetch_x = GB_SCREEN_WIDTH;
+  gb->ppu.pixel_fetcher.x = GB_SCREEN_WIDTH;
+  gb->ppu.pixel_fetcher.tile_addr_mode = true;
+  gb->ppu.frame_ready = true;
+
+  if (!gb->ppu.render_skip) {
+    const GB_ppu_line_t line = {
+      .lcdc = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_LCDC)],
+      .bgp = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_BGP)],
+    };
+    for (uint8_t ly = 0; ly < GB_SCREEN_HEIGHT; ly++) { render_line(gb, &line, ly); }
+  }
+
+  return GB_SUCCESS;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "defs.h"
+#include "thread_pool.h"
 
 typedef enum {
   GB_PPU_MODE_HBLANK = 0,
@@ -58,15 +59,41 @@ typedef struct {
   bool window_entered;
 } GB_ppu_pixel_fetcher_t;
 
+typedef struct {
+  uint8_t lcdc;
+  uint8_t scx;
+  uint8_t scy;
+  uint8_t bgp;
+  uint8_t obp0;
+  uint8_t obp1;
+  uint8_t wx;
+  uint8_t window_line;
+  bool window_entered;
+  uint8_t active_sprite_indices[GB_MAX_OAM_SPRITES_PER_LINE];
+  uint8_t active_sprite_count;
+} GB_ppu_line_t;  // Register state latched at the end of the line drawing, used by the line renderer
+
 typedef struct {
   uint8_t framebuffer[GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT];
   uint16_t cycles;
   GB_ppu_oam_scanline_t oam_scanline;
   GB_ppu_pixel_fetcher_t pixel_fetcher;
   GB_ppu_pixel_fifo_t bg_fifo;
+  GB_ppu_line_t lines[GB_SCREEN_HEIGHT];
+  uint8_t first_pending_line;
+  uint8_t pending_line_count;
+  GB_thread_pool_t *render_pool;  // If set, lines are rasterized in bands on the pool instead of pixel by pixel
+  bool render_skip;               // Frame is emulated for timing only, the framebuffer is left untouched
+  bool frame_ready;               // Set when the PPU enters VBlank
 } GB_ppu_t;
 
 GB_result_t GB_ppu_init(GB_emulator_t *gb);
 GB_result_t GB_ppu_free(GB_emulator_t *gb);
 GB_result_t GB_ppu_tick(GB_emulator_t *gb);
+GB_result_t GB_ppu_flush(GB_emulator_t *gb);
+GB_result_t GB_ppu_set_render_pool(GB_emulator_t *gb, GB_thread_pool_t *pool);
+GB_result_t GB_ppu_set_render_skip(GB_emulator_t *gb, bool skip);
+
+// Timing state and logo frame the boot ROM leaves behind, after GB_memory_skip_boot set up the registers and VRAM
+GB_result_t GB_ppu_skip_boot(GB_emulator_t *gb);
 
@@ -0,0 +1,196 @@
+#include "predicate.h"
+#include "gb.h"  // IWYU pragma: keep
+#include <ctype.h>
+#include <stdlib.h>
+
+static const char *skip_space(const char *text) {
+  while (isspace((unsigned char)*text)) { text++; }
+  return text;
+}
+
+static bool parse_number(const char **cursor, uint32_t max, uint32_t *value) {
+  const char *text = skip_space(*cursor);
+  if (*text == '$') { text++; }
+  if (!isxdigit((unsigned char)*text)) { return false; }
+
+  char *end = NULL;
+  const unsigned long number = strtoul(text, &end, 16);
+  if (number > max) { return false; }
+  *value = (uint32_t)number;
+  *cursor = skip_space(end);
+
+  return true;
+}
+
+static bool parse_op(const char **cursor, uint8_t *op) {
+  static const struct {
+    const char *text;
+    GB_predicate_op_t op;
+  } ops[] = {
+    { "==", GB_PREDICATE_EQUAL },
+    { "!=", GB_PREDICATE_NOT_EQUAL },
+    { "<=", GB_PREDICATE_LESS_EQUAL },
+    { ">=", GB_PREDICATE_GREATER_EQUAL },
+    { "<",  GB_PREDICATE_LESS },
+    { ">",  GB_PREDICATE_GREATER },
+  };
+
+  const char *text = *cursor;
+  for (uint32_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+    const size_t length = strlen(ops[i].text);
+    if (!strncmp(text, ops[i].text, length)) {
+      *op = ops[i].op;
+      *cursor = text + length;
+      return true;
+    }
+  }
+  if (text[0] == '&' && text[1] != '&') {
+    *op = GB_PREDICATE_ANY_BITS;
+    *cursor = text + 1;
+    return true;
+  }
+
+  return false;
+}
+
+static void watch_block(GB_predicate_t *predicate, uint32_t address) {
+  predicate->watched_blocks[address >> 14] |= 1ull << ((address >> 8) & 63);
+}
+
+static void watch_address(GB_predicate_t *predicate, uint16_t address) {
+  // Writes through echo RAM and the mirrors of small cartridge RAMs change the same byte
+  watch_block(predicate, address);
+  if (address >= 0xC000 && address < 0xDE00) { watch_block(predicate, address + 0x2000); }
+  if (address >= 0xE000 && address < 0xFE00) { watch_block(predicate, address - 0x2000); }
+  if (address >= 0xA000 && address < 0xC000) {
+    for (uint32_t block = 0xA000; block < 0xC000; block += 0x100) { watch_block(predicate, block); }
+  }
+}
+
+static bool test_term(const GB_predicate_term_t *term, uint8_t byte) {
+  switch (term->op) {
+    case GB_PREDICATE_EQUAL:         return byte == term->value;
+    case GB_PREDICATE_NOT_EQUAL:     return byte != term->value;
+    case GB_PREDICATE_LESS:          return byte < term->value;
+    case GB_PREDICATE_LESS_EQUAL:    return byte <= term->value;
+    case GB_PREDICATE_GREATER:       return byte > term->value;
+    case GB_PREDICATE_GREATER_EQUAL: return byte >= term->value;
+    case GB_PREDICATE_ANY_BITS:      return (byte & term->value) != 0;
+    default:                         return false;
+  }
+}
+
+GB_result_t GB_predicate_init(GB_predicate_t *predicate, const char *expression) {
+  if (!predicate)  { return GB_ERROR_INVALID_ARGUMENT; }
+  memset(predicate, 0, sizeof(GB_predicate_t));
+  if (!expression) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Every term holds at least one comparison operator, which bounds the term count
+  uint32_t capacity = 1;
+  for (const char *c = expression; *c; c++) { capacity += *c == '=' || *c == '<' || *c == '>' || *c == '&'; }
+  predicate->terms = calloc(capacity, sizeof(GB_predicate_term_t));
+  if (!predicate->terms) { return GB_ERROR_OUT_OF_MEMORY; }
+
+  const char *cursor = expression;
+  GB_result_t result = GB_SUCCESS;
+  while (result == GB_SUCCESS) {
+    uint32_t address = 0;
+    uint32_t value = 0;
+    uint8_t op = 0;
+    if (!parse_number(&cursor, 0xFFFF, &address) || !parse_op(&cursor, &op) || !parse_number(&cursor, 0xFF, &value)) {
+      result = GB_ERROR_INVALID_ARGUMENT;
+      break;
+    }
+
+    GB_predicate_term_t *term = &predicate->terms[predicate->term_count++];
+    term->address = (uint16_t)address;
+    term->op = op;
+    term->value = (uint8_t)value;
+    watch_address(predicate, term->address);
+
+    if (*cursor == '\0') {
+      term->clause_end = true;
+      break;
+    }
+    if (!strncmp(cursor, "||", 2)) {
+      term->clause_end = true;
+    } else if (strncmp(cursor, "&&", 2)) {
+      result = GB_ERROR_INVALID_ARGUMENT;
+    }
+    cursor += 2;
+  }
+
+  if (GB_FAILED(result)) {
+    GB_predicate_free(predicate);
+    return result;
+  }
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_predicate_free(GB_predicate_t *predicate) {
+  if (!predicate) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  free(predicate->terms);
+  memset(predicate, 0, sizeof(GB_predicate_t));
+
+  return GB_SUCCESS;
+}
+
+bool GB_predicate_eval(const GB_predicate_t *predicate, GB_emulator_t *gb) {
+  bool clause = true;
+  for (uint32_t i = 0; i < predicate->term_count; i++) {
+    const GB_predicate_term_t *term = &predicate->terms[i];
+    clause = clause && test_term(term, GB_memory_peek(gb, term->address));
+    if (term->clause_end) {
+      if (clause) { return true; }
+      clause = true;
+    }
+  }
+
+  return false;
+}
+
+GB_result_t GB_predicate_run_cycles(const GB_predicate_t *predicate, GB_emulator_t *gb, uint32_t cycles, bool *matched) {
+  if (!gb)                   { return GB_ERROR_INVALID_EMULATOR; }
+  if (!predicate || !matched) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Resuming from a match would stop again before running anything while the predicate holds
+  const bool resumed = gb->cpu.watch_matched && gb->cpu.watch_match_cycles == gb->timer.cycles;
+  gb->cpu.watch_matched = false;
+  *matched = !resumed && GB_predicate_eval(predicate, gb);
+  if (*matched) {
+    gb->cpu.watch_matched = true;
+    gb->cpu.watch_match_cycles = gb->timer.cycles;
+    return GB_SUCCESS;
+  }
+
+  // Writes only raise a flag, the predicate is evaluated once the writing instruction is complete
+  memcpy(gb->cpu.watched_blocks, predicate->watched_blocks, sizeof(gb->cpu.watched_blocks));
+  gb->cpu.watch_hit = false;
+
+  GB_result_t result = GB_SUCCESS;
+  gb->ppu.frame_ready = false;
+  for (uint32_t t_cycle = 0; t_cycle < cycles && !gb->ppu.frame_ready && result == GB_SUCCESS; ++t_cycle) {
+    result = GB_emulator_tick(gb);
+    if (gb->cpu.watch_hit && GB_cpu_at_instruction_boundary(gb)) {
+      gb->cpu.watch_hit = false;
+      if (GB_predicate_eval(predicate, gb)) {
+        *matched = true;
+        gb->cpu.watch_matched = true;
+        gb->cpu.watch_match_cycles = gb->timer.cycles;
+        break;
+      }
+    }
+  }
+
+  memset(gb->cpu.watched_blocks, 0, sizeof(gb->cpu.watched_blocks));
+  gb->cpu.watch_hit = false;
+  if (result == GB_SUCCESS) { result = GB_ppu_flush(gb); }
+
+  return result;
+}
+
+GB_result_t GB_predicate_run_frame(const GB_predicate_t *predicate, GB_emulator_t *gb, bool *matched) {
+  return GB_predicate_run_cycles(predicate, gb, GB_CYCLES_PER_FRAME, matched);
+}
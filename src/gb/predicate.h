@@ -0,0 +1,42 @@
+#pragma once
+
+#include "defs.h"
+
+typedef enum {
+  GB_PREDICATE_EQUAL = 0,
+  GB_PREDICATE_NOT_EQUAL,
+  GB_PREDICATE_LESS,
+  GB_PREDICATE_LESS_EQUAL,
+  GB_PREDICATE_GREATER,
+  GB_PREDICATE_GREATER_EQUAL,
+  GB_PREDICATE_ANY_BITS       // Some bit of the value is set in the byte
+} GB_predicate_op_t;
+
+typedef struct {
+  uint16_t address;
+  uint8_t op;                 // GB_predicate_op_t
+  uint8_t value;
+  bool clause_end;            // Last term of its clause
+} GB_predicate_term_t;
+
+typedef struct {
+  GB_predicate_term_t *terms; // Clauses of terms joined by AND, the predicate holds when any clause does
+  uint32_t term_count;
+  uint64_t watched_blocks[4]; // 256-byte blocks holding a term address, echo and mirrors included
+} GB_predicate_t;
+
+// Expression compares bytes with values, all in hex, e.g. "D35E == 0 || C0A0 >= 10 && FF85 & 80".
+// Comparisons are ==, !=, <, <=, >, >= and & (any bit set), && binds tighter than ||
+GB_result_t GB_predicate_init(GB_predicate_t *predicate, const char *expression);
+GB_result_t GB_predicate_free(GB_predicate_t *predicate);
+bool GB_predicate_eval(const GB_predicate_t *predicate, GB_emulator_t *gb);
+
+// Runs like GB_emulator_run_frame but stops right after the instruction that made the predicate true,
+// matched tells which one happened. It's evaluated on entry and after CPU writes to watched blocks, bytes
+// changed by the hardware alone (timer, LY, DMA) are seen at the next such write. A call made right where
+// the last one matched skips the entry check, so it runs on to the next write that keeps the predicate
+// true, or finishes the frame
+GB_result_t GB_predicate_run_frame(const GB_predicate_t *predicate, GB_emulator_t *gb, bool *matched);
+
+// Same, but runs at most cycles T-cycles, for budgets that end inside a frame
+GB_result_t GB_predicate_run_cycles(const GB_predicate_t *predicate, GB_emulator_t *gb, uint32_t cycles, bool *matched);
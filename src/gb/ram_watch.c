@@ -0,0 +1,133 @@
+#include "ram_watch.h"
+#include "gb.h"  // IWYU pragma: keep
+#include <ctype.h>
+#include <stdlib.h>
+
+static uint32_t segment_end(uint32_t address) {
+  // Pages are 4KB and the top page is split into OAM, unused, I/O, HRAM and IE
+  static const uint32_t region_ends[] = { 0xFE00, 0xFEA0, 0xFF00, 0xFF80, 0xFFFF, 0x10000 };
+  if (address < 0xF000) { return (address & ~(uint32_t)(GB_MEMORY_PAGE_SIZE - 1)) + GB_MEMORY_PAGE_SIZE; }
+
+  uint32_t i = 0;
+  while (region_ends[i] <= address) { i++; }
+  return region_ends[i];
+}
+
+static GB_result_t add_range(GB_ram_watch_t *watch, uint32_t first, uint32_t last, uint32_t *capacity) {
+  for (uint32_t address = first; address <= last;) {
+    if (watch->segment_count == *capacity) {
+      const uint32_t new_capacity = *capacity ? *capacity * 2 : 16;
+      GB_ram_watch_segment_t *segments = realloc(watch->segments, new_capacity * sizeof(GB_ram_watch_segment_t));
+      if (!segments) { return GB_ERROR_OUT_OF_MEMORY; }
+      watch->segments = segments;
+      *capacity = new_capacity;
+    }
+
+    const uint32_t end = segment_end(address) <= last ? segment_end(address) : last + 1;
+    watch->segments[watch->segment_count++] = (GB_ram_watch_segment_t){
+      .address = (uint16_t)address,
+      .length = (uint16_t)(end - address),
+      .offset = (uint32_t)watch->size,
+    };
+    watch->size += end - address;
+    address = end;
+  }
+
+  return GB_SUCCESS;
+}
+
+static bool parse_address(const char **cursor, uint32_t *address) {
+  const char *text = *cursor;
+  while (isspace((unsigned char)*text)) { text++; }
+  if (*text == '$') { text++; }
+  if (!isxdigit((unsigned char)*text)) { return false; }
+
+  char *end = NULL;
+  const unsigned long value = strtoul(text, &end, 16);
+  if (value > 0xFFFF) { return false; }
+  while (isspace((unsigned char)*end)) { end++; }
+  *address = (uint32_t)value;
+  *cursor = end;
+
+  return true;
+}
+
+static const uint8_t *segment_source(GB_emulator_t *gb, uint16_t address) {
+  // NULL for regions that aren't plain memory, they're peeked byte by byte
+  GB_memory_t *memory = &gb->memory;
+  if (address < 0x4000) { return memory->rom_0 ? memory->rom_0 + address : NULL; }
+  if (address < 0x8000) { return memory->mbc.rom_x ? memory->mbc.rom_x + (address - 0x4000) : NULL; }
+  if (address < 0xA000) { return &GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(address)); }
+  if (address < 0xC000) { return NULL; }
+  if (address < 0xE000) { return &GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_WRAM, GB_MEMORY_WRAM_OFFSET(address)); }
+  if (address < 0xFE00) { return &GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_WRAM, GB_MEMORY_ECHO_OFFSET(address)); }
+  if (address < 0xFEA0) { return &memory->oam[GB_MEMORY_OAM_OFFSET(address)]; }
+  if (address < 0xFF00) { return NULL; }
+  if (address < 0xFF80) { return &memory->io[GB_MEMORY_IO_OFFSET(address)]; }
+  if (address < 0xFFFF) { return &memory->hram[GB_MEMORY_HRAM_OFFSET(address)]; }
+  return memory->ie;
+}
+
+GB_result_t GB_ram_watch_init(GB_ram_watch_t *watch, const char *spec) {
+  if (!watch) { return GB_ERROR_INVALID_ARGUMENT; }
+  memset(watch, 0, sizeof(GB_ram_watch_t));
+  if (!spec)  { return GB_ERROR_INVALID_ARGUMENT; }
+
+  uint32_t capacity = 0;
+  const char *cursor = spec;
+  GB_result_t result = GB_SUCCESS;
+  while (result == GB_SUCCESS) {
+    uint32_t first = 0;
+    uint32_t last = 0;
+    if (!parse_address(&cursor, &first)) {
+      result = GB_ERROR_INVALID_ARGUMENT;
+      break;
+    }
+    last = first;
+    if (*cursor == '-') {
+      cursor++;
+      if (!parse_address(&cursor, &last) || last < first) {
+        result = GB_ERROR_INVALID_ARGUMENT;
+        break;
+      }
+    }
+
+    result = add_range(watch, first, last, &capacity);
+    if (*cursor == '\0') { break; }
+    if (*cursor++ != ',') { result = GB_ERROR_INVALID_ARGUMENT; }
+  }
+
+  if (GB_FAILED(result)) {
+    GB_ram_watch_free(watch);
+    return result;
+  }
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_ram_watch_free(GB_ram_watch_t *watch) {
+  if (!watch) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  free(watch->segments);
+  memset(watch, 0, sizeof(GB_ram_watch_t));
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_ram_watch_gather(const GB_ram_watch_t *watch, GB_emulator_t *gb, uint8_t *out) {
+  if (!gb)           { return GB_ERROR_INVALID_EMULATOR; }
+  if (!watch || !out) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Pages are looked up on every call, forks and copy-on-write move them
+  for (uint32_t i = 0; i < watch->segment_count; i++) {
+    const GB_ram_watch_segment_t *segment = &watch->segments[i];
+    const uint8_t *source = segment_source(gb, segment->address);
+    if (source) {
+      memcpy(out + segment->offset, source, segment->length);
+      continue;
+    }
+    for (uint32_t b = 0; b < segment->length; b++) { out[segment->offset + b] = GB_memory_peek(gb, segment->address + b); }
+  }
+
+  return GB_SUCCESS;
+}
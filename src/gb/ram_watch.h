@@ -0,0 +1,23 @@
+#pragma once
+
+#include "defs.h"
+
+typedef struct {
+  uint16_t address;
+  uint16_t length;
+  uint32_t offset;          // Position of the first byte in the gathered vector
+} GB_ram_watch_segment_t;   // Bytes that don't cross a page or region boundary
+
+typedef struct {
+  GB_ram_watch_segment_t *segments;
+  uint32_t segment_count;
+  size_t size;              // Bytes gathered per call
+} GB_ram_watch_t;
+
+// Spec lists addresses and inclusive ranges in hex separated by commas, e.g. "C0A0-C0AF,D35E,$FF85".
+// Bytes are gathered in the order given, I/O registers as stored and cartridge RAM from its mapped bank
+GB_result_t GB_ram_watch_init(GB_ram_watch_t *watch, const char *spec);
+GB_result_t GB_ram_watch_free(GB_ram_watch_t *watch);
+
+// Copies the watched bytes into out, watch->size bytes, without allocating
+GB_result_t GB_ram_watch_gather(const GB_ram_watch_t *watch, GB_emulator_t *gb, uint8_t *out);
@@ -0,0 +1,260 @@
+#include "rewind.h"
+#include "gb.h"  // IWYU pragma: keep
+#include "rle.h"
+
+static bool reserve(uint8_t **buffer, size_t *capacity, size_t size) {
+  if (*capacity >= size) { return true; }
+
+  uint8_t *data = realloc(*buffer, size);
+  if (!data) { return false; }
+  *buffer = data;
+  *capacity = size;
+
+  return true;
+}
+
+static GB_rewind_entry_t *entry_at(GB_rewind_t *rewind, uint32_t index) {
+  return &rewind->entries[(rewind->first_entry + index) % rewind->config.max_frames];
+}
+
+static void drop_oldest_entry(GB_rewind_t *rewind) {
+  // Every entry only depends on the newer ones, so history is trimmed from the tail
+  rewind->first_entry = (rewind->first_entry + 1) % rewind->config.max_frames;
+  rewind->entry_count--;
+}
+
+static bool allocate_entry(GB_rewind_t *rewind, size_t size, size_t *offset) {
+  const size_t capacity = rewind->config.memory_budget;
+  if (size > capacity) { return false; }
+
+  if (rewind->entry_count == rewind->config.max_frames) { drop_oldest_entry(rewind); }
+
+  // History is a ring of variable sized entries, an entry is never split at the end
+  while (rewind->entry_count > 0) {
+    const GB_rewind_entry_t *oldest = entry_at(rewind, 0);
+    const GB_rewind_entry_t *newest = entry_at(rewind, rewind->entry_count - 1);
+    const size_t head = newest->offset + newest->encoded_size;
+    if (newest->offset >= oldest->offset) {
+      if (capacity - head >= size) { *offset = head; return true; }
+      if (oldest->offset >= size)  { *offset = 0;    return true; }
+    } else if (oldest->offset - head >= size) {
+      *offset = head;
+      return true;
+    }
+    drop_oldest_entry(rewind);
+  }
+
+  *offset = 0;
+  return true;
+}
+
+static void compress_frame(GB_rewind_t *rewind, GB_rewind_slot_t *slot) {
+  // The previous frame is stored relative to the new one, so rewinding
+  // steps backwards from the newest state one XOR at a time
+  if (rewind->reference_size > 0 && !reserve(&rewind->scratch, &rewind->scratch_capacity, GB_rle_encoded_size_bound(rewind->reference_size))) {
+    rewind->entry_count = 0;
+  } else if (rewind->reference_size > 0) {
+    const bool keyframe = rewind->reference_size != slot->size ||
+                          (rewind->config.keyframe_interval > 0 && ++rewind->frames_since_keyframe >= rewind->config.keyframe_interval);
+    if (keyframe) { rewind->frames_since_keyframe = 0; }
+
+    const size_t encoded_size = GB_rle_encode(rewind->scratch, rewind->reference, keyframe ? NULL : slot->data, rewind->reference_size);
+    size_t offset = 0;
+    if (allocate_entry(rewind, encoded_size, &offset)) {
+      memcpy(rewind->history + offset, rewind->scratch, encoded_size);
+      GB_rewind_entry_t *entry = entry_at(rewind, rewind->entry_count++);
+      entry->offset = offset;
+      entry->encoded_size = (uint32_t)encoded_size;
+      entry->state_size = (uint32_t)rewind->reference_size;
+      entry->keyframe = keyframe;
+    } else {
+      // Older entries can't be reached without this one
+      rewind->entry_count = 0;
+    }
+  }
+
+  // New frame becomes the reference, buffers are swapped instead of copied
+  uint8_t *data = rewind->reference;
+  const size_t capacity = rewind->reference_capacity;
+  rewind->reference = slot->data;
+  rewind->reference_capacity = slot->capacity;
+  rewind->reference_size = slot->size;
+  slot->data = data;
+  slot->capacity = capacity;
+  slot->size = 0;
+}
+
+static void *worker_main(void *arg) {
+  GB_rewind_t *rewind = arg;
+
+  pthread_mutex_lock(&rewind->mutex);
+  for (;;) {
+    while (!rewind->shutdown && rewind->slot_count == 0) {
+      pthread_cond_wait(&rewind->work_cond, &rewind->mutex);
+    }
+    if (rewind->slot_count == 0) { break; }
+
+    // Staged slot is owned by the worker until it is released
+    GB_rewind_slot_t *slot = &rewind->slots[rewind->first_slot];
+    rewind->worker_busy = true;
+    pthread_mutex_unlock(&rewind->mutex);
+
+    compress_frame(rewind, slot);
+
+    pthread_mutex_lock(&rewind->mutex);
+    rewind->first_slot = (rewind->first_slot + 1) % GB_REWIND_STAGING_SLOTS;
+    rewind->slot_count--;
+    rewind->worker_busy = false;
+    if (rewind->slot_count == 0) { pthread_cond_broadcast(&rewind->idle_cond); }
+  }
+  pthread_mutex_unlock(&rewind->mutex);
+
+  return NULL;
+}
+
+static void wait_idle(GB_rewind_t *rewind) {
+  while (rewind->slot_count > 0 || rewind->worker_busy) {
+    pthread_cond_wait(&rewind->idle_cond, &rewind->mutex);
+  }
+}
+
+GB_result_t GB_rewind_init(GB_rewind_t *rewind, const GB_rewind_config_t *config) {
+  if (!rewind) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  memset(rewind, 0, sizeof(GB_rewind_t));
+  rewind->config.memory_budget = GB_REWIND_DEFAULT_MEMORY_BUDGET;
+  rewind->config.keyframe_interval = GB_REWIND_DEFAULT_KEYFRAME_INTERVAL;
+  rewind->config.max_frames = GB_REWIND_DEFAULT_MAX_FRAMES;
+  if (config) { rewind->config = *config; }
+  if (rewind->config.memory_budget == 0 || rewind->config.max_frames == 0) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  rewind->history = malloc(rewind->config.memory_budget);
+  rewind->entries = calloc(rewind->config.max_frames, sizeof(GB_rewind_entry_t));
+  if (!rewind->history || !rewind->entries) {
+    free(rewind->history);
+    free(rewind->entries);
+    return GB_ERROR_OUT_OF_MEMORY;
+  }
+
+  pthread_mutex_init(&rewind->mutex, NULL);
+  pthread_cond_init(&rewind->work_cond, NULL);
+  pthread_cond_init(&rewind->idle_cond, NULL);
+  if (pthread_create(&rewind->worker, NULL, worker_main, rewind) != 0) {
+    pthread_cond_destroy(&rewind->idle_cond);
+    pthread_cond_destroy(&rewind->work_cond);
+    pthread_mutex_destroy(&rewind->mutex);
+    free(rewind->history);
+    free(rewind->entries);
+    return GB_ERROR_OUT_OF_MEMORY;
+  }
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_rewind_free(GB_rewind_t *rewind) {
+  if (!rewind) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  pthread_mutex_lock(&rewind->mutex);
+  rewind->shutdown = true;
+  pthread_cond_broadcast(&rewind->work_cond);
+  pthread_mutex_unlock(&rewind->mutex);
+  pthread_join(rewind->worker, NULL);
+
+  for (uint32_t i = 0; i < GB_REWIND_STAGING_SLOTS; i++) { free(rewind->slots[i].data); }
+  free(rewind->scratch);
+  free(rewind->reference);
+  free(rewind->entries);
+  free(rewind->history);
+
+  pthread_cond_destroy(&rewind->idle_cond);
+  pthread_cond_destroy(&rewind->work_cond);
+  pthread_mutex_destroy(&rewind->mutex);
+  memset(rewind, 0, sizeof(GB_rewind_t));
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_rewind_push(GB_rewind_t *rewind, GB_emulator_t *gb) {
+  if (!gb)     { return GB_ERROR_INVALID_EMULATOR; }
+  if (!rewind) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  pthread_mutex_lock(&rewind->mutex);
+  if (rewind->slot_count == GB_REWIND_STAGING_SLOTS) {
+    // Compression fell behind, the frame is skipped and the next delta just spans two frames
+    rewind->dropped_frames++;
+    pthread_mutex_unlock(&rewind->mutex);
+    return GB_SUCCESS;
+  }
+  GB_rewind_slot_t *slot = &rewind->slots[(rewind->first_slot + rewind->slot_count) % GB_REWIND_STAGING_SLOTS];
+  pthread_mutex_unlock(&rewind->mutex);
+
+  // Free slot is not visible to the worker, so it is filled without the lock
+  const size_t size = GB_emulator_state_size(gb);
+  if (!reserve(&slot->data, &slot->capacity, size)) { return GB_ERROR_OUT_OF_MEMORY; }
+  GB_TRY(GB_emulator_save_state(gb, slot->data, slot->capacity, &slot->size));
+
+  pthread_mutex_lock(&rewind->mutex);
+  rewind->slot_count++;
+  pthread_cond_signal(&rewind->work_cond);
+  pthread_mutex_unlock(&rewind->mutex);
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_rewind_pop(GB_rewind_t *rewind, GB_emulator_t *gb) {
+  if (!gb)     { return GB_ERROR_INVALID_EMULATOR; }
+  if (!rewind) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  pthread_mutex_lock(&rewind->mutex);
+  wait_idle(rewind);
+  if (rewind->entry_count == 0) {
+    pthread_mutex_unlock(&rewind->mutex);
+    return GB_ERROR_REWIND_EMPTY;
+  }
+
+  // Newest entry restores the frame before the reference
+  const GB_rewind_entry_t *entry = entry_at(rewind, rewind->entry_count - 1);
+  if (!reserve(&rewind->reference, &rewind->reference_capacity, entry->state_size)) {
+    pthread_mutex_unlock(&rewind->mutex);
+    return GB_ERROR_OUT_OF_MEMORY;
+  }
+  if (!GB_rle_decode(rewind->history + entry->offset, entry->encoded_size, rewind->reference, entry->state_size, !entry->keyframe)) {
+    rewind->entry_count = 0;
+    rewind->reference_size = 0;
+    pthread_mutex_unlock(&rewind->mutex);
+    return GB_ERROR_INVALID_STATE;
+  }
+  rewind->reference_size = entry->state_size;
+  rewind->entry_count--;
+  if (rewind->frames_since_keyframe > 0) { rewind->frames_since_keyframe--; }
+
+  const GB_result_t result = GB_emulator_load_state(gb, rewind->reference, rewind->reference_size);
+  pthread_mutex_unlock(&rewind->mutex);
+
+  return result;
+}
+
+GB_result_t GB_rewind_clear(GB_rewind_t *rewind) {
+  if (!rewind) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  pthread_mutex_lock(&rewind->mutex);
+  wait_idle(rewind);
+  rewind->first_entry = 0;
+  rewind->entry_count = 0;
+  rewind->frames_since_keyframe = 0;
+  rewind->reference_size = 0;
+  pthread_mutex_unlock(&rewind->mutex);
+
+  return GB_SUCCESS;
+}
+
+uint32_t GB_rewind_frame_count(GB_rewind_t *rewind) {
+  if (!rewind) { return 0; }
+
+  pthread_mutex_lock(&rewind->mutex);
+  wait_idle(rewind);
+  const uint32_t frame_count = rewind->entry_count;
+  pthread_mutex_unlock(&rewind->mutex);
+
+  return frame_count;
+}
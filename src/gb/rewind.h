@@ -0,0 +1,66 @@
+#pragma once
+
+#include "defs.h"
+#include <pthread.h>
+
+#define GB_REWIND_DEFAULT_MEMORY_BUDGET     (64 * 1024 * 1024)
+#define GB_REWIND_DEFAULT_KEYFRAME_INTERVAL (60)     // One keyframe per second of emulated time
+#define GB_REWIND_DEFAULT_MAX_FRAMES        (36000)  // Ten minutes at 60 fps
+#define GB_REWIND_STAGING_SLOTS             (8)      // Frames that can wait for compression
+
+typedef struct {
+  size_t memory_budget;         // Bytes of compressed history, older frames are dropped first
+  uint32_t keyframe_interval;   // Every N-th frame is stored in full instead of as a delta
+  uint32_t max_frames;
+} GB_rewind_config_t;
+
+typedef struct {
+  size_t offset;                // Offset of the encoded data in the history buffer
+  uint32_t encoded_size;
+  uint32_t state_size;
+  bool keyframe;                // Full state, otherwise XOR with the state of the next frame
+} GB_rewind_entry_t;
+
+typedef struct {
+  uint8_t *data;
+  size_t capacity;
+  size_t size;
+} GB_rewind_slot_t;
+
+typedef struct {
+  GB_rewind_config_t config;
+
+  // History of encoded frames, newest entry describes the frame before the reference state
+  uint8_t *history;
+  GB_rewind_entry_t *entries;
+  uint32_t first_entry;
+  uint32_t entry_count;
+  uint64_t frames_since_keyframe;
+
+  // Newest state, previous frames are restored backwards from it
+  uint8_t *reference;
+  size_t reference_capacity;
+  size_t reference_size;
+  uint8_t *scratch;             // Encoder output, copied into the history once the size is known
+  size_t scratch_capacity;
+
+  // Frames captured on the emulation thread, compressed by the worker
+  GB_rewind_slot_t slots[GB_REWIND_STAGING_SLOTS];
+  uint32_t first_slot;
+  uint32_t slot_count;
+  uint64_t dropped_frames;
+
+  pthread_t worker;
+  pthread_mutex_t mutex;
+  pthread_cond_t work_cond;     // Signaled when a frame is staged or on shutdown
+  pthread_cond_t idle_cond;     // Signaled when the worker drained the staging slots
+  bool worker_busy;
+  bool shutdown;
+} GB_rewind_t;
+
+GB_result_t GB_rewind_init(GB_rewind_t *rewind, const GB_rewind_config_t *config);
+GB_result_t GB_rewind_free(GB_rewind_t *rewind);
+GB_result_t GB_rewind_push(GB_rewind_t *rewind, GB_emulator_t *gb);
+GB_result_t GB_rewind_pop(GB_rewind_t *rewind, GB_emulator_t *gb);
+GB_result_t GB_rewind_clear(GB_rewind_t *rewind);
+uint32_t GB_rewind_frame_count(GB_rewind_t *rewind);
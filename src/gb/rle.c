@@ -0,0 +1,102 @@
+#include "rle.h"
+
+size_t GB_rle_encoded_size_bound(size_t size) {
+  // Every token is two varints of at most 5 bytes and tokens are separated by zero runs
+  return size + (size / GB_RLE_MIN_ZERO_RUN + 2) * 10;
+}
+
+static uint8_t *write_varint(uint8_t *out, uint32_t value) {
+  while (value >= 0x80) {
+    *out++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = (uint8_t)value;
+
+  return out;
+}
+
+static bool read_varint(const uint8_t **in, const uint8_t *end, uint32_t *value) {
+  *value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (*in >= end) { return false; }
+    const uint8_t byte = *(*in)++;
+    *value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) { return true; }
+  }
+
+  return false;
+}
+
+static inline uint8_t delta_at(const uint8_t *data, const uint8_t *base, size_t index) {
+  return base ? data[index] ^ base[index] : data[index];
+}
+
+static size_t zero_run_length(const uint8_t *data, const uint8_t *base, size_t offset, size_t size) {
+  size_t index = offset;
+
+  // Unchanged memory is skipped a word at a time
+  while (index + sizeof(uint64_t) <= size) {
+    uint64_t value, base_value = 0;
+    memcpy(&value, data + index, sizeof(uint64_t));
+    if (base) { memcpy(&base_value, base + index, sizeof(uint64_t)); }
+    if (value != base_value) { break; }
+    index += sizeof(uint64_t);
+  }
+  while (index < size && delta_at(data, base, index) == 0) { index++; }
+
+  return index - offset;
+}
+
+// Run-length encodes data XOR base (or the data itself without a base) as
+// pairs of zero run and literal run lengths, each followed by the literal bytes
+size_t GB_rle_encode(uint8_t *out, const uint8_t *data, const uint8_t *base, size_t size) {
+  uint8_t *cursor = out;
+  size_t index = 0;
+  while (index < size) {
+    const size_t zero_run = zero_run_length(data, base, index, size);
+    index += zero_run;
+
+    // Literal run ends at the first long enough zero run
+    const size_t literal_start = index;
+    while (index < size) {
+      if (delta_at(data, base, index) != 0) { index++; continue; }
+      const size_t next_zero_run = zero_run_length(data, base, index, size);
+      if (next_zero_run >= GB_RLE_MIN_ZERO_RUN || index + next_zero_run == size) { break; }
+      index += next_zero_run;
+    }
+
+    cursor = write_varint(cursor, (uint32_t)zero_run);
+    cursor = write_varint(cursor, (uint32_t)(index - literal_start));
+    for (size_t i = literal_start; i < index; i++) {
+      *cursor++ = delta_at(data, base, i);
+    }
+  }
+
+  return cursor - out;
+}
+
+bool GB_rle_decode(const uint8_t *in, size_t in_size, uint8_t *data, size_t size, bool delta) {
+  const uint8_t *end = in + in_size;
+  size_t index = 0;
+  while (in < end) {
+    uint32_t zero_run, literal_run;
+    if (!read_varint(&in, end, &zero_run) ||
+        !read_varint(&in, end, &literal_run) ||
+        size - index < (size_t)zero_run + literal_run ||
+        (size_t)(end - in) < literal_run) { return false; }
+
+    // Zero runs of a delta leave the data unchanged
+    if (!delta) { memset(data + index, 0, zero_run); }
+    index += zero_run;
+
+    if (delta) {
+      for (uint32_t i = 0; i < literal_run; i++) { data[index + i] ^= in[i]; }
+    } else {
+      memcpy(data + index, in, literal_run);
+    }
+    index += literal_run;
+    in += literal_run;
+  }
+
+  return index == size;
+}
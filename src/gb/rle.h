@@ -0,0 +1,9 @@
+#pragma once
+
+#include "defs.h"
+
+#define GB_RLE_MIN_ZERO_RUN (8)  // Literal runs are split only by zero runs at least this long
+
+size_t GB_rle_encoded_size_bound(size_t size);
+size_t GB_rle_encode(uint8_t *out, const uint8_t *data, const uint8_t *base, size_t size);
+bool GB_rle_decode(const uint8_t *in, size_t in_size, uint8_t *data, size_t size, bool delta);
@@ -0,0 +1,109 @@
+#include "rom.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+
+GB_result_t GB_rom_load(GB_rom_t **rom, const char *path) {
+  if (!rom || !path) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Open ROM file
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) { return GB_ERROR_IO; }
+
+  // Calculate ROM size
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      (size_t)file_stat.st_size < (sizeof(GB_rom_header_t) + 0x0100)) {
+    close(fd);
+    return GB_ERROR_IO;
+  }
+  const size_t file_size = file_stat.st_size;
+
+  // Read ROM header
+  GB_rom_header_t rom_header;
+  if (pread(fd, &rom_header, sizeof(GB_rom_header_t), 0x0100) != sizeof(GB_rom_header_t)) {
+    close(fd);
+    return GB_ERROR_IO;
+  }
+
+  // Determine the number of ROM banks based on the header
+  size_t rom_bank_count = 2;  // Default to 2 banks (32KB)
+  if (rom_header.rom_size <= 0x08) {
+    rom_bank_count = 2 << rom_header.rom_size;
+  } else {
+    close(fd);
+    return GB_ERROR_IO;
+  }
+
+  // Determine the number of external RAM banks
+  uint8_t ram_bank_count = 0;
+  switch (rom_header.ram_size) {
+    case 0x00: ram_bank_count = 0; break;
+    case 0x01: ram_bank_count = 1; break;
+    case 0x02: ram_bank_count = 1; break;
+    case 0x03: ram_bank_count = 4; break;
+    case 0x04: ram_bank_count = 16; break;
+    case 0x05: ram_bank_count = 8; break;
+    default:
+      close(fd);
+      return GB_ERROR_IO;
+  }
+
+  GB_rom_t *new_rom = calloc(1, sizeof(GB_rom_t));
+  if (!new_rom) {
+    close(fd);
+    return GB_ERROR_OUT_OF_MEMORY;
+  }
+
+  // Reserve all banks with zero pages, so undersized ROMs are padded instead of failing
+  const size_t rom_mapping_size = rom_bank_count * 0x4000;
+  uint8_t *rom_data = mmap(NULL, rom_mapping_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (rom_data == MAP_FAILED) {
+    free(new_rom);
+    close(fd);
+    return GB_ERROR_OUT_OF_MEMORY;
+  }
+
+  // Map the file over the reservation, ROM pages are shared with the page cache
+  const size_t file_mapping_size = file_size < rom_mapping_size ? file_size : rom_mapping_size;
+  if (mmap(rom_data, file_mapping_size, PROT_READ, MAP_PRIVATE | MAP_FIXED | MAP_POPULATE, fd, 0) == MAP_FAILED) {
+    munmap(rom_data, rom_mapping_size);
+    free(new_rom);
+    close(fd);
+    return GB_ERROR_IO;
+  }
+  close(fd);
+
+  // Bank switching makes the access pattern random, no need for read-around
+  madvise(rom_data, file_mapping_size, MADV_RANDOM);
+  madvise(rom_data, file_mapping_size, MADV_WILLNEED);
+
+  atomic_init(&new_rom->ref_count, 1);
+  new_rom->data = rom_data;
+  new_rom->size = rom_mapping_size;
+  new_rom->bank_count = rom_bank_count;
+  new_rom->ram_bank_count = ram_bank_count;
+  new_rom->header = rom_header;
+  *rom = new_rom;
+
+  return GB_SUCCESS;
+}
+
+GB_rom_t *GB_rom_retain(GB_rom_t *rom) {
+  if (rom) { atomic_fetch_add(&rom->ref_count, 1); }
+
+  return rom;
+}
+
+void GB_rom_release(GB_rom_t *rom) {
+  if (!rom) { return; }
+  if (atomic_fetch_sub(&rom->ref_count, 1) != 1) { return; }
+
+  munmap((void *)rom->data, rom->size);
+  free(rom);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "defs.h"
+#include "memory.h"
+#include <stdatomic.h>
+
+struct GB_rom {
+  atomic_uint ref_count;
+  const uint8_t *data;       // Read-only ROM file mapping, padded with zero pages up to bank_count banks
+  size_t size;
+  uint16_t bank_count;
+  uint8_t ram_bank_count;
+  GB_rom_header_t header;
+};
+
+GB_result_t GB_rom_load(GB_rom_t **rom, const char *path);
+GB_rom_t *GB_rom_retain(GB_rom_t *rom);
+void GB_rom_release(GB_rom_t *rom);
@@ -0,0 +1,55 @@
+#include "scene.h"
+#include "gb.h"  // IWYU pragma: keep
+
+static void read_map(const GB_memory_t *memory, uint16_t base_addr, bool unsigned_tiles, GB_scene_map_t *map) {
+  // With LCDC.4 clear tiles 0-127 come from $9000 and 128-255 from $8800, numbered 256-383 and 128-255
+  for (uint32_t i = 0; i < GB_SCENE_MAP_SIZE * GB_SCENE_MAP_SIZE; i++) {
+    const uint8_t tile_index = GB_MEMORY_PAGED(memory, GB_MEMORY_PAGE_VRAM, GB_MEMORY_VRAM_OFFSET(base_addr + i));
+    map->tiles[i] = (unsigned_tiles || tile_index >= 0x80) ? tile_index : 0x100 + tile_index;
+  }
+}
+
+GB_result_t GB_scene_read(GB_emulator_t *gb, GB_scene_t *scene) {
+  if (!gb)    { return GB_ERROR_INVALID_EMULATOR; }
+  if (!scene) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  const GB_memory_t *memory = &gb->memory;
+  const uint8_t lcdc = memory->io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_LCDC)];
+  const bool lcd_enabled = lcdc & GB_PPU_LCDC_ENABLE;
+  const bool bg_enabled = lcd_enabled && (lcdc & GB_PPU_LCDC_BG_WINDOW_ENABLE);
+  scene->lcdc = lcdc;
+
+  // Sprites
+  const uint8_t height = 8 << ((lcdc & GB_PPU_LCDC_OBJ_SIZE) != 0);
+  const bool sprites_enabled = lcd_enabled && (lcdc & GB_PPU_LCDC_OBJ_ENABLE);
+  for (uint32_t i = 0; i < GB_MAX_OAM_SPRITES; i++) {
+    GB_scene_sprite_t *sprite = &scene->sprites[i];
+    memcpy(&sprite->oam, &memory->oam[i * sizeof(GB_oam_sprite_t)], sizeof(GB_oam_sprite_t));
+    sprite->x = sprite->oam.x - 8;
+    sprite->y = sprite->oam.y - 16;
+    sprite->height = height;
+    sprite->visible = sprites_enabled && sprite->x > -8 && sprite->x < GB_SCREEN_WIDTH &&
+                      sprite->y > -height && sprite->y < GB_SCREEN_HEIGHT;
+  }
+
+  // Tile maps
+  const bool unsigned_tiles = lcdc & GB_PPU_LCDC_BG_WINDOW_TILES;
+  read_map(memory, (lcdc & GB_PPU_LCDC_BG_TILE_MAP) ? 0x9C00 : 0x9800, unsigned_tiles, &scene->background);
+  scene->background.scroll_x = memory->io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_SCX)];
+  scene->background.scroll_y = memory->io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_SCY)];
+  scene->background.visible = bg_enabled;
+
+  const uint8_t wx = memory->io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_WX)];
+  const uint8_t wy = memory->io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_WY)];
+  read_map(memory, (lcdc & GB_PPU_LCDC_WINDOW_TILE_MAP) ? 0x9C00 : 0x9800, unsigned_tiles, &scene->window);
+  scene->window.scroll_x = 7 - wx;
+  scene->window.scroll_y = -wy;
+  scene->window.visible = bg_enabled && (lcdc & GB_PPU_LCDC_WINDOW_ENABLE) && wx < GB_SCREEN_WIDTH + 7 && wy < GB_SCREEN_HEIGHT;
+
+  // Work RAM
+  scene->wram[0] = memory->page_data[GB_MEMORY_PAGE_WRAM];
+  scene->wram[1] = memory->page_data[GB_MEMORY_PAGE_WRAM + 1];
+  scene->hram = memory->hram;
+
+  return GB_SUCCESS;
+}
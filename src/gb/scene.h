@@ -0,0 +1,35 @@
+#pragma once
+
+#include "defs.h"
+#include "ppu.h"
+
+#define GB_SCENE_MAP_SIZE (32)  // Tile maps are 32 x 32 tiles
+
+typedef struct {
+  GB_oam_sprite_t oam;      // Entry as stored in OAM
+  int16_t x;                // Screen position of the top left pixel, OAM X - 8 and OAM Y - 16
+  int16_t y;
+  uint8_t height;           // 8 or 16 with LCDC.2 set
+  bool visible;             // Sprites are enabled and it overlaps the screen, the 10 per line limit isn't applied
+} GB_scene_sprite_t;
+
+typedef struct {
+  uint16_t tiles[GB_SCENE_MAP_SIZE * GB_SCENE_MAP_SIZE];  // Tile of every cell numbered from $8000 (0-383), the same in both addressing modes
+  int16_t scroll_x;         // Screen pixel (x, y) shows map pixel (x + scroll_x, y + scroll_y), wrapped around for BG
+  int16_t scroll_y;
+  bool visible;
+} GB_scene_map_t;
+
+typedef struct {
+  GB_scene_sprite_t sprites[GB_MAX_OAM_SPRITES];
+  GB_scene_map_t background;
+  GB_scene_map_t window;    // Scroll is minus its position on screen
+  uint8_t lcdc;
+  const uint8_t *wram[2];   // $C000 and $D000 banks, valid until the emulator is forked, unshared or freed
+  const uint8_t *hram;
+} GB_scene_t;
+
+// Decodes sprites and tile maps from the current OAM, VRAM and registers into the caller's scene
+// without allocating. Scroll registers can change mid-frame, the values at the call are used,
+// so it's meant to be called at VBlank, right after GB_emulator_run_frame
+GB_result_t GB_scene_read(GB_emulator_t *gb, GB_scene_t *scene);
@@ -0,0 +1,54 @@
+#include "serial.h"
+#include "gb.h"  // IWYU pragma: keep
+
+static GB_result_t reset(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  memset(&gb->serial, 0, sizeof(GB_serial_t));
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_serial_init(GB_emulator_t *gb) {
+  return reset(gb);
+}
+
+GB_result_t GB_serial_free(GB_emulator_t *gb) {
+  return reset(gb);
+}
+
+GB_result_t GB_serial_tick(GB_emulator_t *gb) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+  if (!gb->serial.transferring || gb->timer.cycles < gb->serial.end_cycles) { return GB_SUCCESS; }
+
+  // Nothing is connected, so the received byte is all ones
+  gb->serial.transferring = false;
+  gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_SB)] = 0xFF;
+  gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_SC)] &= ~0x80;
+
+  return GB_interrupt_request(gb, GB_INTERRUPT_SERIAL);
+}
+
+GB_result_t GB_serial_write_control(GB_emulator_t *gb, uint8_t value) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  // Transfers on the external clock never complete without a partner
+  if (!(value & 0x80) || !(value & 0x01) || gb->serial.transferring) { return GB_SUCCESS; }
+
+  gb->serial.transferring = true;
+  gb->serial.end_cycles = gb->timer.cycles + GB_SERIAL_TRANSFER_CYCLES;
+  if (gb->serial.output) {
+    gb->serial.output(gb->serial.output_context, gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_SB)]);
+  }
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_serial_set_output(GB_emulator_t *gb, GB_serial_output_t output, void *context) {
+  if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
+
+  gb->serial.output = output;
+  gb->serial.output_context = context;
+
+  return GB_SUCCESS;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "defs.h"
+
+#define GB_SERIAL_TRANSFER_CYCLES (8 * 512)  // 8 bits with the 8192 Hz internal clock
+
+typedef void (*GB_serial_output_t)(void *context, uint8_t value);
+
+typedef struct {
+  // No link partner is emulated, a transfer shifts in 0xFF
+  bool transferring;
+  uint64_t end_cycles;          // Timer cycle counter at which the running transfer completes
+  GB_serial_output_t output;    // Receives every byte the game sends, owned by the caller
+  void *output_context;
+} GB_serial_t;
+
+GB_result_t GB_serial_init(GB_emulator_t *gb);
+GB_result_t GB_serial_free(GB_emulator_t *gb);
+GB_result_t GB_serial_tick(GB_emulator_t *gb);
+GB_result_t GB_serial_write_control(GB_emulator_t *gb, uint8_t value);
+GB_result_t GB_serial_set_output(GB_emulator_t *gb, GB_serial_output_t output, void *context);
@@ -0,0 +1,76 @@
+#include "snapshot.h"
+#include "gb.h"  // IWYU pragma: keep
+#include <stdlib.h>
+
+GB_result_t GB_snapshot_pool_init(GB_snapshot_pool_t *pool, uint32_t capacity) {
+  if (!pool)         { return GB_ERROR_INVALID_ARGUMENT; }
+  memset(pool, 0, sizeof(GB_snapshot_pool_t));
+  if (capacity == 0) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  // Snapshots are never moved, other emulators share their pages
+  pool->snapshots = calloc(capacity, sizeof(GB_emulator_t));
+  if (!pool->snapshots) { return GB_ERROR_OUT_OF_MEMORY; }
+  pool->capacity = capacity;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_snapshot_pool_free(GB_snapshot_pool_t *pool) {
+  if (!pool) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  for (uint32_t i = 0; i < pool->count; i++) { GB_emulator_free(&pool->snapshots[i]); }
+  free(pool->snapshots);
+  memset(pool, 0, sizeof(GB_snapshot_pool_t));
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_snapshot_pool_add(GB_snapshot_pool_t *pool, GB_emulator_t *source) {
+  if (!source)                      { return GB_ERROR_INVALID_EMULATOR; }
+  if (!pool || !pool->snapshots)    { return GB_ERROR_INVALID_ARGUMENT; }
+  if (pool->count == pool->capacity) { return GB_ERROR_BUFFER_TOO_SMALL; }
+
+  GB_emulator_t *snapshot = &pool->snapshots[pool->count];
+  const GB_result_t result = GB_emulator_fork(snapshot, source);
+  if (GB_FAILED(result)) {
+    GB_emulator_free(snapshot);
+    memset(snapshot, 0, sizeof(GB_emulator_t));
+    return result;
+  }
+  pool->count++;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_snapshot_pool_add_state(GB_snapshot_pool_t *pool, GB_rom_t *rom, const void *state, size_t size) {
+  if (!pool || !pool->snapshots || !rom || !state) { return GB_ERROR_INVALID_ARGUMENT; }
+  if (pool->count == pool->capacity)              { return GB_ERROR_BUFFER_TOO_SMALL; }
+
+  GB_emulator_t *snapshot = &pool->snapshots[pool->count];
+  GB_result_t result = GB_emulator_init(snapshot);
+  if (result == GB_SUCCESS) { result = GB_emulator_attach_rom(snapshot, rom); }
+  if (result == GB_SUCCESS) { result = GB_emulator_load_state(snapshot, state, size); }
+  if (result == GB_SUCCESS) { result = GB_memory_share_pages(snapshot); }  // Restored emulators take its pages
+  if (GB_FAILED(result)) {
+    GB_emulator_free(snapshot);
+    memset(snapshot, 0, sizeof(GB_emulator_t));
+    return result;
+  }
+  pool->count++;
+
+  return GB_SUCCESS;
+}
+
+const GB_emulator_t *GB_snapshot_pool_pick(const GB_snapshot_pool_t *pool, uint32_t *random_state) {
+  if (!pool || pool->count == 0) { return NULL; }
+  if (pool->count == 1)          { return &pool->snapshots[0]; }
+
+  // xorshift32
+  uint32_t x = *random_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *random_state = x;
+
+  return &pool->snapshots[(uint64_t)x * pool->count >> 32];
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "defs.h"
+
+typedef struct {
+  GB_emulator_t *snapshots;   // Frozen forks, restored with GB_emulator_reset_to
+  uint32_t count;
+  uint32_t capacity;
+} GB_snapshot_pool_t;
+
+GB_result_t GB_snapshot_pool_init(GB_snapshot_pool_t *pool, uint32_t capacity);
+GB_result_t GB_snapshot_pool_free(GB_snapshot_pool_t *pool);
+
+// Adds the current state of source, which keeps running, its pages are shared until it writes them
+GB_result_t GB_snapshot_pool_add(GB_snapshot_pool_t *pool, GB_emulator_t *source);
+
+// Adds a save state of a cartridge, e.g. start states prepared ahead of time
+GB_result_t GB_snapshot_pool_add_state(GB_snapshot_pool_t *pool, GB_rom_t *rom, const void *state, size_t size);
+
+// Picks a snapshot uniformly with the caller's random state, which must not be 0
+const GB_emulator_t *GB_snapshot_pool_pick(const GB_snapshot_pool_t *pool, uint32_t *random_state);
@@ -0,0 +1,471 @@
+#include "state.h"
+#include "gb.h"  // IWYU pragma: keep
+#include <stddef.h>
+
+#if defined(GB_BIG_ENDIAN)
+#define GB_STATE_NATIVE_FLAGS GB_STATE_FLAG_BIG_ENDIAN
+#else
+#define GB_STATE_NATIVE_FLAGS 0
+#endif
+
+;
+#pragma pack(push, 1)
+
+typedef struct {
+  GB_register_file_t reg;
+  uint16_t instr_id;        // GB_CPU_INSTR_ID_*
+  uint8_t phase;
+  uint16_t addr;
+  uint16_t target;
+  uint8_t read_value;
+  uint8_t write_value;
+  uint8_t ime_pending_delay;
+  uint8_t halted;
+  uint8_t stopped;
+} GB_state_cpu_t;
+
+typedef struct {
+  uint16_t cycles;
+  GB_ppu_oam_scanline_t oam_scanline;
+  uint8_t fetcher_step;
+  uint16_t fetcher_next_step_cycle;
+  uint8_t fetcher_fetch_x;
+  uint8_t fetcher_x;
+  uint8_t fetcher_scy;
+  uint8_t fetcher_scx;
+  uint8_t fetcher_tile_addr_mode;
+  uint8_t fetcher_tile_index;
+  uint8_t fetcher_tile_low;
+  uint8_t fetcher_tile_high;
+  uint8_t fetcher_wx;
+  uint8_t fetcher_wy;
+  uint8_t fetcher_window_line;
+  uint8_t fetcher_window_entered;
+  GB_ppu_pixel_fifo_t bg_fifo;
+  uint8_t first_pending_line;
+  uint8_t pending_line_count;
+  uint8_t framebuffer[GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT];
+} GB_state_ppu_t;  // Followed by pending_line_count latched lines
+
+typedef struct {
+  uint16_t div_counter;
+  uint64_t cycles;
+} GB_state_timer_t;
+
+typedef struct {
+  uint8_t active;
+  uint8_t source_high;
+  uint8_t copied;
+  uint64_t start_cycles;
+} GB_state_dma_t;
+
+typedef struct {
+  uint8_t transferring;
+  uint64_t end_cycles;
+} GB_state_serial_t;
+
+typedef struct {
+  uint16_t rom_bank;
+  uint8_t ram_bank;
+  uint8_t mode;
+  uint8_t ram_enabled;
+  uint8_t header_checksum;  // Guards against loading a state of another cartridge
+  uint8_t global_checksum[2];
+  uint8_t rtc_base[GB_RTC_REGISTER_COUNT];
+  uint64_t rtc_base_cycles;
+  int64_t rtc_base_time;
+  uint8_t rtc_latched[GB_RTC_REGISTER_COUNT];
+  uint8_t rtc_latch_value;
+} GB_state_mbc_t;
+
+typedef struct {
+  uint8_t external_ram_bank_count;
+} GB_state_memory_t;  // Followed by the private memory arena, WRAM, VRAM and external RAM banks
+
+#pragma pack(pop)
+
+#define GB_STATE_SECTION_COUNT (7)
+
+typedef struct {
+  const GB_state_cpu_t *cpu;
+  const GB_state_ppu_t *ppu;
+  const GB_ppu_line_t *ppu_lines;
+  const GB_state_timer_t *timer;
+  const GB_state_dma_t *dma;
+  const GB_state_serial_t *serial;
+  const GB_state_mbc_t *mbc;
+  const GB_state_memory_t *memory;
+  const uint8_t *memory_arena;
+} GB_state_sections_t;
+
+static size_t ppu_section_size(GB_emulator_t *gb) {
+  return sizeof(GB_state_ppu_t) + gb->ppu.pending_line_count * sizeof(GB_ppu_line_t);
+}
+
+static size_t memory_arena_size(uint8_t external_ram_bank_count) {
+  return sizeof(GB_memory_arena_t) + (GB_MEMORY_PAGE_EXTERNAL_RAM + external_ram_bank_count * 2) * GB_MEMORY_PAGE_SIZE;
+}
+
+static size_t memory_section_size(GB_emulator_t *gb) {
+  return sizeof(GB_state_memory_t) + memory_arena_size(gb->memory.external_ram_bank_count);
+}
+
+static void *begin_section(uint8_t **cursor, uint32_t id, size_t size) {
+  GB_state_section_t section = { .id = id, .size = (uint32_t)size };
+  memcpy(*cursor, &section, sizeof(GB_state_section_t));
+
+  void *payload = *cursor + sizeof(GB_state_section_t);
+  *cursor += sizeof(GB_state_section_t) + size;
+
+  return payload;
+}
+
+static void save_cpu(GB_emulator_t *gb, GB_state_cpu_t *state, uint16_t instr_id) {
+  state->reg = gb->cpu.reg;
+  state->instr_id = instr_id;
+  state->phase = gb->cpu.phase;
+  state->addr = gb->cpu.addr;
+  state->target = gb->cpu.target;
+  state->read_value = gb->cpu.read_value;
+  state->write_value = gb->cpu.write_value;
+  state->ime_pending_delay = gb->cpu.ime_pending_delay;
+  state->halted = gb->cpu.halted;
+  state->stopped = gb->cpu.stopped;
+}
+
+static void save_ppu(GB_emulator_t *gb, GB_state_ppu_t *state) {
+  const GB_ppu_pixel_fetcher_t *fetcher = &gb->ppu.pixel_fetcher;
+  state->cycles = gb->ppu.cycles;
+  state->oam_scanline = gb->ppu.oam_scanline;
+  state->fetcher_step = (uint8_t)fetcher->step;
+  state->fetcher_next_step_cycle = fetcher->next_step_cycle;
+  state->fetcher_fetch_x = fetcher->fetch_x;
+  state->fetcher_x = fetcher->x;
+  state->fetcher_scy = fetcher->scy;
+  state->fetcher_scx = fetcher->scx;
+  state->fetcher_tile_addr_mode = fetcher->tile_addr_mode;
+  state->fetcher_tile_index = fetcher->tile_index;
+  state->fetcher_tile_low = fetcher->tile_low;
+  state->fetcher_tile_high = fetcher->tile_high;
+  state->fetcher_wx = fetcher->wx;
+  state->fetcher_wy = fetcher->wy;
+  state->fetcher_window_line = fetcher->window_line;
+  state->fetcher_window_entered = fetcher->window_entered;
+  state->bg_fifo = gb->ppu.bg_fifo;
+  state->first_pending_line = gb->ppu.first_pending_line;
+  state->pending_line_count = gb->ppu.pending_line_count;
+  memcpy(state->framebuffer, gb->ppu.framebuffer, sizeof(state->framebuffer));
+
+  // Lines latched but not rendered yet are kept, so saving never forces a flush
+  memcpy((uint8_t *)state + sizeof(GB_state_ppu_t),
+         &gb->ppu.lines[gb->ppu.first_pending_line],
+         gb->ppu.pending_line_count * sizeof(GB_ppu_line_t));
+}
+
+static void save_mbc(GB_emulator_t *gb, GB_state_mbc_t *state) {
+  memset(state, 0, sizeof(GB_state_mbc_t));
+  state->rom_bank = gb->memory.mbc.rom_bank;
+  state->ram_bank = gb->memory.mbc.ram_bank;
+  state->mode = gb->memory.mbc.mode;
+  state->ram_enabled = gb->memory.mbc.ram_enabled;
+  memcpy(state->rtc_base, gb->memory.mbc.rtc.base, GB_RTC_REGISTER_COUNT);
+  state->rtc_base_cycles = gb->memory.mbc.rtc.base_cycles;
+  state->rtc_base_time = gb->memory.mbc.rtc.base_time;
+  memcpy(state->rtc_latched, gb->memory.mbc.rtc.latched, GB_RTC_REGISTER_COUNT);
+  state->rtc_latch_value = gb->memory.mbc.rtc.latch_value;
+  if (gb->memory.rom) {
+    state->header_checksum = gb->memory.rom->header.header_checksum;
+    memcpy(state->global_checksum, gb->memory.rom->header.global_checksum, sizeof(state->global_checksum));
+  }
+}
+
+size_t GB_emulator_state_size(GB_emulator_t *gb) {
+  if (!gb) { return 0; }
+
+  return sizeof(GB_state_header_t) +
+         sizeof(GB_state_section_t) * GB_STATE_SECTION_COUNT +
+         sizeof(GB_state_cpu_t) +
+         ppu_section_size(gb) +
+         sizeof(GB_state_timer_t) +
+         sizeof(GB_state_dma_t) +
+         sizeof(GB_state_serial_t) +
+         sizeof(GB_state_mbc_t) +
+         memory_section_size(gb);
+}
+
+GB_result_t GB_emulator_save_state(GB_emulator_t *gb, void *buffer, size_t size, size_t *written) {
+  if (!gb)                { return GB_ERROR_INVALID_EMULATOR; }
+  if (!buffer)            { return GB_ERROR_INVALID_ARGUMENT; }
+  if (!gb->memory.arena)  { return GB_ERROR_INVALID_MEMORY_ACCESS; }
+
+  const size_t state_size = GB_emulator_state_size(gb);
+  if (size < state_size) { return GB_ERROR_BUFFER_TOO_SMALL; }
+
+  uint16_t instr_id = 0;
+  GB_TRY(GB_cpu_get_instr_id(gb, &instr_id));
+
+  // Header
+  const GB_state_header_t header = {
+    .magic = GB_STATE_MAGIC,
+    .version = GB_STATE_VERSION,
+    .flags = GB_STATE_NATIVE_FLAGS,
+    .size = (uint32_t)state_size,
+    .section_count = GB_STATE_SECTION_COUNT
+  };
+  uint8_t *cursor = buffer;
+  memcpy(cursor, &header, sizeof(GB_state_header_t));
+  cursor += sizeof(GB_state_header_t);
+
+  // Sections
+  save_cpu(gb, begin_section(&cursor, GB_STATE_SECTION_CPU, sizeof(GB_state_cpu_t)), instr_id);
+  save_ppu(gb, begin_section(&cursor, GB_STATE_SECTION_PPU, ppu_section_size(gb)));
+
+  GB_state_timer_t *timer = begin_section(&cursor, GB_STATE_SECTION_TIMER, sizeof(GB_state_timer_t));
+  timer->div_counter = gb->timer.div_counter;
+  timer->cycles = gb->timer.cycles;
+
+  GB_state_dma_t *dma = begin_section(&cursor, GB_STATE_SECTION_DMA, sizeof(GB_state_dma_t));
+  dma->active = gb->dma.active;
+  dma->source_high = gb->dma.source_high;
+  dma->copied = gb->dma.copied;
+  dma->start_cycles = gb->dma.start_cycles;
+
+  GB_state_serial_t *serial = begin_section(&cursor, GB_STATE_SECTION_SERIAL, sizeof(GB_state_serial_t));
+  serial->transferring = gb->serial.transferring;
+  serial->end_cycles = gb->serial.end_cycles;
+
+  save_mbc(gb, begin_section(&cursor, GB_STATE_SECTION_MBC, sizeof(GB_state_mbc_t)));
+
+  // All RAM regions and I/O registers are stored as one contiguous block
+  GB_state_memory_t *memory = begin_section(&cursor, GB_STATE_SECTION_MEMORY, memory_section_size(gb));
+  memory->external_ram_bank_count = gb->memory.external_ram_bank_count;
+  uint8_t *memory_data = (uint8_t *)memory + sizeof(GB_state_memory_t);
+  memcpy(memory_data, gb->memory.arena, sizeof(GB_memory_arena_t));
+  memory_data += sizeof(GB_memory_arena_t);
+  for (uint8_t page = 0; page < gb->memory.page_count; page++) {
+    memcpy(memory_data + page * GB_MEMORY_PAGE_SIZE, gb->memory.page_data[page], GB_MEMORY_PAGE_SIZE);
+  }
+
+  if (written) { *written = state_size; }
+
+  return GB_SUCCESS;
+}
+
+static bool are_valid_sprites(const uint8_t *indices, uint8_t count, uint8_t max_count) {
+  // Sprite indices address OAM directly
+  if (count > max_count) { return false; }
+  for (uint8_t i = 0; i < count; i++) {
+    if (indices[i] >= GB_MAX_OAM_SPRITES) { return false; }
+  }
+
+  return true;
+}
+
+static bool is_valid_ppu(const GB_state_ppu_t *ppu, const GB_ppu_line_t *lines, const uint8_t *io) {
+  const GB_ppu_oam_scanline_t *scanline = &ppu->oam_scanline;
+  if (!are_valid_sprites(scanline->visible_sprite_indices, scanline->visible_sprite_count, GB_MAX_OAM_SPRITES) ||
+      !are_valid_sprites(scanline->active_sprite_indices, scanline->active_sprite_count, GB_MAX_OAM_SPRITES_PER_LINE) ||
+      ppu->fetcher_step > GB_PPU_PIXEL_FETCHER_STEP_PUSH ||
+      ppu->fetcher_x > GB_SCREEN_WIDTH ||
+      ppu->bg_fifo.count > sizeof(ppu->bg_fifo.pixels)) { return false; }
+  for (uint8_t i = 0; i < ppu->pending_line_count; i++) {
+    if (!are_valid_sprites(lines[i].active_sprite_indices, lines[i].active_sprite_count, GB_MAX_OAM_SPRITES_PER_LINE)) { return false; }
+  }
+
+  // Lines outside the screen are only ever in VBlank, the drawing mode writes the pixel at x before
+  // moving on and the OAM scan adds at most one sprite per cycle
+  const uint8_t ly = io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_LY)];
+  const uint8_t mode = io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_STAT)] & GB_PPU_STAT_MODE;
+  if (ly >= GB_SCREEN_HEIGHT + 10 ||
+      (mode != GB_PPU_MODE_VBLANK && ly >= GB_SCREEN_HEIGHT) ||
+      (mode == GB_PPU_MODE_DRAWING && ppu->fetcher_x >= GB_SCREEN_WIDTH) ||
+      (mode == GB_PPU_MODE_OAM && ppu->cycles < GB_MAX_OAM_SPRITES && scanline->visible_sprite_count > ppu->cycles)) { return false; }
+
+  return true;
+}
+
+static bool is_valid_mbc(const GB_state_mbc_t *mbc) {
+  // Widest registers are the 9 bit MBC5 ROM bank and the 1 bit flags, any RAM bank is valid
+  // since MBC3 keeps the whole byte and the mapping wraps around the RAM size
+  return mbc->rom_bank <= 0x1FF && mbc->mode <= 1 && mbc->ram_enabled <= 1;
+}
+
+static GB_result_t find_sections(GB_emulator_t *gb, const uint8_t *data, size_t size, GB_state_sections_t *sections) {
+  if (size < sizeof(GB_state_header_t)) { return GB_ERROR_INVALID_STATE; }
+
+  GB_state_header_t header;
+  memcpy(&header, data, sizeof(GB_state_header_t));
+  if (header.magic != GB_STATE_MAGIC ||
+      header.version != GB_STATE_VERSION ||
+      header.flags != GB_STATE_NATIVE_FLAGS ||
+      header.size > size) { return GB_ERROR_INVALID_STATE; }
+
+  // Unknown sections are skipped, so newer writers may append data
+  memset(sections, 0, sizeof(GB_state_sections_t));
+  size_t offset = sizeof(GB_state_header_t);
+  for (uint32_t i = 0; i < header.section_count; i++) {
+    GB_state_section_t section;
+    if (header.size - offset < sizeof(GB_state_section_t)) { return GB_ERROR_INVALID_STATE; }
+    memcpy(&section, data + offset, sizeof(GB_state_section_t));
+    offset += sizeof(GB_state_section_t);
+    if (header.size - offset < section.size) { return GB_ERROR_INVALID_STATE; }
+
+    const uint8_t *payload = data + offset;
+    switch (section.id) {
+      case GB_STATE_SECTION_CPU:
+        if (section.size != sizeof(GB_state_cpu_t)) { return GB_ERROR_INVALID_STATE; }
+        sections->cpu = (const GB_state_cpu_t *)payload;
+        if (!GB_cpu_is_valid_instr_id(sections->cpu->instr_id)) { return GB_ERROR_INVALID_STATE; }
+        break;
+      case GB_STATE_SECTION_PPU:
+        if (section.size < sizeof(GB_state_ppu_t)) { return GB_ERROR_INVALID_STATE; }
+        sections->ppu = (const GB_state_ppu_t *)payload;
+        sections->ppu_lines = (const GB_ppu_line_t *)(payload + sizeof(GB_state_ppu_t));
+        if (section.size != sizeof(GB_state_ppu_t) + sections->ppu->pending_line_count * sizeof(GB_ppu_line_t) ||
+            sections->ppu->first_pending_line + sections->ppu->pending_line_count > GB_SCREEN_HEIGHT) { return GB_ERROR_INVALID_STATE; }
+        break;
+      case GB_STATE_SECTION_TIMER:
+        if (section.size != sizeof(GB_state_timer_t)) { return GB_ERROR_INVALID_STATE; }
+        sections->timer = (const GB_state_timer_t *)payload;
+        break;
+      case GB_STATE_SECTION_DMA:
+        if (section.size != sizeof(GB_state_dma_t)) { return GB_ERROR_INVALID_STATE; }
+        sections->dma = (const GB_state_dma_t *)payload;
+        if (sections->dma->copied > GB_DMA_LENGTH || sections->dma->active > 1) { return GB_ERROR_INVALID_STATE; }
+        break;
+      case GB_STATE_SECTION_SERIAL:
+        if (section.size != sizeof(GB_state_serial_t)) { return GB_ERROR_INVALID_STATE; }
+        sections->serial = (const GB_state_serial_t *)payload;
+        break;
+      case GB_STATE_SECTION_MBC:
+        if (section.size != sizeof(GB_state_mbc_t)) { return GB_ERROR_INVALID_STATE; }
+        sections->mbc = (const GB_state_mbc_t *)payload;
+        if (!is_valid_mbc(sections->mbc)) { return GB_ERROR_INVALID_STATE; }
+        break;
+      case GB_STATE_SECTION_MEMORY:
+        if (section.size < sizeof(GB_state_memory_t)) { return GB_ERROR_INVALID_STATE; }
+        sections->memory = (const GB_state_memory_t *)payload;
+        sections->memory_arena = payload + sizeof(GB_state_memory_t);
+        if (section.size != sizeof(GB_state_memory_t) + memory_arena_size(sections->memory->external_ram_bank_count)) { return GB_ERROR_INVALID_STATE; }
+        break;
+      default:
+        break;
+    }
+    offset += section.size;
+  }
+
+  if (!sections->cpu   ||
+      !sections->ppu   ||
+      !sections->timer ||
+      !sections->dma   ||
+      !sections->serial ||
+      !sections->mbc   ||
+      !sections->memory) { return GB_ERROR_INVALID_STATE; }
+
+  // PPU fields index OAM, the FIFO and the framebuffer, so they're checked against the restored registers
+  if (!is_valid_ppu(sections->ppu, sections->ppu_lines, sections->memory_arena + offsetof(GB_memory_arena_t, io))) { return GB_ERROR_INVALID_STATE; }
+
+  // State must match the attached cartridge
+  if (sections->memory->external_ram_bank_count != gb->memory.external_ram_bank_count) { return GB_ERROR_INVALID_STATE; }
+  if (gb->memory.rom &&
+      (sections->mbc->header_checksum != gb->memory.rom->header.header_checksum ||
+       memcmp(sections->mbc->global_checksum, gb->memory.rom->header.global_checksum, sizeof(sections->mbc->global_checksum)) != 0)) { return GB_ERROR_INVALID_STATE; }
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_emulator_load_state(GB_emulator_t *gb, const void *buffer, size_t size) {
+  if (!gb)               { return GB_ERROR_INVALID_EMULATOR; }
+  if (!buffer)           { return GB_ERROR_INVALID_ARGUMENT; }
+  if (!gb->memory.arena) { return GB_ERROR_INVALID_MEMORY_ACCESS; }
+
+  // Whole state is validated before anything is changed, so a bad state leaves the emulator untouched
+  GB_state_sections_t sections;
+  GB_TRY(find_sections(gb, buffer, size, &sections));
+
+  // Pages shared with forks are copied first, so running out of memory halfway still leaves the
+  // emulator as it was, and the external RAM comparison below sees the old contents
+  for (uint8_t page = 0; page < gb->memory.page_count; page++) {
+    GB_TRY(GB_memory_unshare_page(gb, page, true));
+  }
+  GB_TRY(GB_cpu_set_instr_id(gb, sections.cpu->instr_id));
+
+  // CPU
+  const GB_state_cpu_t *cpu = sections.cpu;
+  gb->cpu.reg = cpu->reg;
+  gb->cpu.phase = cpu->phase;
+  gb->cpu.addr = cpu->addr;
+  gb->cpu.target = cpu->target;
+  gb->cpu.read_value = cpu->read_value;
+  gb->cpu.write_value = cpu->write_value;
+  gb->cpu.ime_pending_delay = cpu->ime_pending_delay;
+  gb->cpu.halted = cpu->halted;
+  gb->cpu.stopped = cpu->stopped;
+
+  // PPU
+  const GB_state_ppu_t *ppu = sections.ppu;
+  GB_ppu_pixel_fetcher_t *fetcher = &gb->ppu.pixel_fetcher;
+  gb->ppu.cycles = ppu->cycles;
+  gb->ppu.oam_scanline = ppu->oam_scanline;
+  fetcher->step = (GB_ppu_pixel_fetcher_step_t)ppu->fetcher_step;
+  fetcher->next_step_cycle = ppu->fetcher_next_step_cycle;
+  fetcher->fetch_x = ppu->fetcher_fetch_x;
+  fetcher->x = ppu->fetcher_x;
+  fetcher->scy = ppu->fetcher_scy;
+  fetcher->scx = ppu->fetcher_scx;
+  fetcher->tile_addr_mode = ppu->fetcher_tile_addr_mode;
+  fetcher->tile_index = ppu->fetcher_tile_index;
+  fetcher->tile_low = ppu->fetcher_tile_low;
+  fetcher->tile_high = ppu->fetcher_tile_high;
+  fetcher->wx = ppu->fetcher_wx;
+  fetcher->wy = ppu->fetcher_wy;
+  fetcher->window_line = ppu->fetcher_window_line;
+  fetcher->window_entered = ppu->fetcher_window_entered;
+  gb->ppu.bg_fifo = ppu->bg_fifo;
+  gb->ppu.first_pending_line = ppu->first_pending_line;
+  gb->ppu.pending_line_count = ppu->pending_line_count;
+  memcpy(gb->ppu.framebuffer, ppu->framebuffer, sizeof(ppu->framebuffer));
+  memcpy(&gb->ppu.lines[ppu->first_pending_line], sections.ppu_lines, ppu->pending_line_count * sizeof(GB_ppu_line_t));
+
+  // Timer
+  gb->timer.div_counter = sections.timer->div_counter;
+  gb->timer.cycles = sections.timer->cycles;
+
+  // Serial, the output callback stays with the emulator
+  gb->serial.transferring = sections.serial->transferring != 0;
+  gb->serial.end_cycles = sections.serial->end_cycles;
+
+  // MBC
+  gb->memory.mbc.rom_bank = sections.mbc->rom_bank;
+  gb->memory.mbc.ram_bank = sections.mbc->ram_bank;
+  gb->memory.mbc.mode = sections.mbc->mode;
+  gb->memory.mbc.ram_enabled = sections.mbc->ram_enabled;
+  memcpy(gb->memory.mbc.rtc.base, sections.mbc->rtc_base, GB_RTC_REGISTER_COUNT);
+  gb->memory.mbc.rtc.base_cycles = sections.mbc->rtc_base_cycles;
+  gb->memory.mbc.rtc.base_time = sections.mbc->rtc_base_time;
+  memcpy(gb->memory.mbc.rtc.latched, sections.mbc->rtc_latched, GB_RTC_REGISTER_COUNT);
+  gb->memory.mbc.rtc.latch_value = sections.mbc->rtc_latch_value;
+  GB_TRY(GB_mbc_remap(gb));  // Only fails without an emulator, the banks were checked by find_sections
+
+  // Memory
+  const uint8_t *memory_data = sections.memory_arena;
+  memcpy(gb->memory.arena, memory_data, sizeof(GB_memory_arena_t));
+  memory_data += sizeof(GB_memory_arena_t);
+  for (uint8_t page = 0; page < gb->memory.page_count; page++) {
+    const uint8_t *page_data = memory_data + page * GB_MEMORY_PAGE_SIZE;
+    if (page >= GB_MEMORY_PAGE_EXTERNAL_RAM && memcmp(gb->memory.page_data[page], page_data, GB_MEMORY_PAGE_SIZE) != 0) {
+      gb->memory.external_ram_dirty = true;
+    }
+    memcpy(gb->memory.page_data[page], page_data, GB_MEMORY_PAGE_SIZE);
+  }
+  gb->memory.dirty_pages = gb->memory.page_count < 64 ? (1ull << gb->memory.page_count) - 1 : ~0ull;
+
+  // DMA source is resolved against the restored memory map
+  gb->dma.active = sections.dma->active != 0;
+  gb->dma.source_high = sections.dma->source_high;
+  gb->dma.copied = sections.dma->copied;
+  gb->dma.start_cycles = sections.dma->start_cycles;
+  GB_TRY(GB_dma_remap(gb));
+
+  return GB_SUCCESS;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "defs.h"
+
+#define GB_STATE_MAGIC    (0x54534247)  // "GBST"
+#define GB_STATE_VERSION  (5)  // 5: serial transfer
+
+#define GB_STATE_SECTION_CPU    (0x20555043)  // "CPU "
+#define GB_STATE_SECTION_PPU    (0x20555050)  // "PPU "
+#define GB_STATE_SECTION_TIMER  (0x524D4954)  // "TIMR"
+#define GB_STATE_SECTION_DMA    (0x20414D44)  // "DMA "
+#define GB_STATE_SECTION_SERIAL (0x204F4953)  // "SIO "
+#define GB_STATE_SECTION_MBC    (0x2043424D)  // "MBC "
+#define GB_STATE_SECTION_MEMORY (0x204D454D)  // "MEM "
+
+;
+#pragma pack(push, 1)
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t flags;           // GB_STATE_FLAG_*
+  uint32_t size;            // Size of the whole state including this header
+  uint32_t section_count;
+} GB_state_header_t;
+
+typedef struct {
+  uint32_t id;              // GB_STATE_SECTION_*
+  uint32_t size;            // Size of the payload following this header
+} GB_state_section_t;
+
+#pragma pack(pop)
+
+#define GB_STATE_FLAG_BIG_ENDIAN (1 << 0)  // State is stored in the native byte order of the host
+
+size_t GB_emulator_state_size(GB_emulator_t *gb);
+GB_result_t GB_emulator_save_state(GB_emulator_t *gb, void *buffer, size_t size, size_t *written);
+GB_result_t GB_emulator_load_state(GB_emulator_t *gb, const void *buffer, size_t size);
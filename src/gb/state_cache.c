@@ -0,0 +1,210 @@
+#include "state_cache.h"
+#include "gb.h"  // IWYU pragma: keep
+#include "rle.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define GB_STATE_CACHE_SUFFIX ".state"
+
+typedef struct {
+  char name[NAME_MAX + 1];
+  uint64_t size;
+  struct timespec used;       // Modification time, bumped by every load
+} cache_entry_t;
+
+static bool entry_path(char *out, const GB_state_cache_t *cache, const GB_state_cache_key_t *key) {
+  char sha1[GB_HASH_SHA1_SIZE * 2 + 1];
+  for (uint32_t i = 0; i < GB_HASH_SHA1_SIZE; i++) { snprintf(&sha1[i * 2], 3, "%02x", key->rom_sha1[i]); }
+
+  const int length = snprintf(out, PATH_MAX, "%s/%s-%016llx" GB_STATE_CACHE_SUFFIX,
+                              cache->directory, sha1, (unsigned long long)key->prefix_hash);
+  return length > 0 && length < PATH_MAX;
+}
+
+static bool write_all(int fd, const uint8_t *data, size_t size) {
+  while (size > 0) {
+    const ssize_t written = write(fd, data, size);
+    if (written < 0) { return false; }
+    data += written;
+    size -= written;
+  }
+
+  return true;
+}
+
+static int compare_entries(const void *a, const void *b) {
+  const cache_entry_t *entry_a = a;
+  const cache_entry_t *entry_b = b;
+  if (entry_a->used.tv_sec != entry_b->used.tv_sec) { return entry_a->used.tv_sec < entry_b->used.tv_sec ? -1 : 1; }
+  if (entry_a->used.tv_nsec != entry_b->used.tv_nsec) { return entry_a->used.tv_nsec < entry_b->used.tv_nsec ? -1 : 1; }
+  return strcmp(entry_a->name, entry_b->name);
+}
+
+static void evict(const GB_state_cache_t *cache) {
+  // Other threads and processes may evict at the same time, files that are already gone are skipped
+  DIR *directory = opendir(cache->directory);
+  if (!directory) { return; }
+
+  cache_entry_t *entries = NULL;
+  size_t count = 0;
+  size_t capacity = 0;
+  uint64_t total_size = 0;
+  const size_t suffix_length = strlen(GB_STATE_CACHE_SUFFIX);
+  for (struct dirent *dirent = readdir(directory); dirent; dirent = readdir(directory)) {
+    const size_t length = strlen(dirent->d_name);
+    if (length <= suffix_length || strcmp(dirent->d_name + length - suffix_length, GB_STATE_CACHE_SUFFIX)) { continue; }
+
+    struct stat file_stat;
+    if (fstatat(dirfd(directory), dirent->d_name, &file_stat, 0) != 0 || !S_ISREG(file_stat.st_mode)) { continue; }
+
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      cache_entry_t *grown = realloc(entries, capacity * sizeof(cache_entry_t));
+      if (!grown) { break; }
+      entries = grown;
+    }
+    cache_entry_t *entry = &entries[count++];
+    memcpy(entry->name, dirent->d_name, length + 1);
+    entry->size = (uint64_t)file_stat.st_size;
+    entry->used = file_stat.st_mtim;
+    total_size += entry->size;
+  }
+
+  if (total_size > cache->max_size) {
+    qsort(entries, count, sizeof(cache_entry_t), compare_entries);
+    for (size_t i = 0; i < count && total_size > cache->max_size; i++) {
+      unlinkat(dirfd(directory), entries[i].name, 0);
+      total_size -= entries[i].size;
+    }
+  }
+
+  free(entries);
+  closedir(directory);
+}
+
+GB_result_t GB_state_cache_init(GB_state_cache_t *cache, const char *directory, uint64_t max_size) {
+  if (!cache)     { return GB_ERROR_INVALID_ARGUMENT; }
+  memset(cache, 0, sizeof(GB_state_cache_t));
+  if (!directory) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  struct stat directory_stat;
+  if (mkdir(directory, 0755) != 0 && errno != EEXIST) { return GB_ERROR_IO; }
+  if (stat(directory, &directory_stat) != 0 || !S_ISDIR(directory_stat.st_mode)) { return GB_ERROR_IO; }
+
+  cache->directory = strdup(directory);
+  if (!cache->directory) { return GB_ERROR_OUT_OF_MEMORY; }
+  cache->max_size = max_size;
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_state_cache_free(GB_state_cache_t *cache) {
+  if (!cache) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  free(cache->directory);
+  memset(cache, 0, sizeof(GB_state_cache_t));
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_state_cache_load(const GB_state_cache_t *cache, const GB_state_cache_key_t *key, GB_emulator_t *gb) {
+  if (!gb)                                     { return GB_ERROR_INVALID_EMULATOR; }
+  if (!cache || !cache->directory || !key)     { return GB_ERROR_INVALID_ARGUMENT; }
+
+  char path[PATH_MAX];
+  if (!entry_path(path, cache, key)) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) { return GB_ERROR_STATE_CACHE_MISS; }
+
+  // Entry is decoded straight from the mapping, truncated or corrupted files are misses
+  struct stat file_stat;
+  const uint8_t *file = MAP_FAILED;
+  if (fstat(fd, &file_stat) == 0 && (size_t)file_stat.st_size >= sizeof(GB_state_cache_header_t)) {
+    file = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  if (file == MAP_FAILED) {
+    close(fd);
+    return GB_ERROR_STATE_CACHE_MISS;
+  }
+
+  GB_state_cache_header_t header;
+  memcpy(&header, file, sizeof(GB_state_cache_header_t));
+  const uint8_t *encoded = file + sizeof(GB_state_cache_header_t);
+  const bool valid = header.magic == GB_STATE_CACHE_MAGIC &&
+                     header.version == GB_STATE_CACHE_VERSION &&
+                     !memcmp(&header.key, key, sizeof(GB_state_cache_key_t)) &&
+                     (size_t)file_stat.st_size == sizeof(GB_state_cache_header_t) + header.encoded_size &&
+                     GB_hash_crc32(0, encoded, header.encoded_size) == header.crc;
+
+  GB_result_t result = GB_ERROR_STATE_CACHE_MISS;
+  if (valid) {
+    uint8_t *state = malloc(header.state_size ? header.state_size : 1);
+    if (!state) {
+      result = GB_ERROR_OUT_OF_MEMORY;
+    } else if (GB_rle_decode(encoded, header.encoded_size, state, header.state_size, false)) {
+      result = GB_emulator_load_state(gb, state, header.state_size);
+      if (GB_FAILED(result) && result != GB_ERROR_OUT_OF_MEMORY) { result = GB_ERROR_STATE_CACHE_MISS; }
+    }
+    free(state);
+  }
+  munmap((void *)file, file_stat.st_size);
+
+  // Modification time orders the entries for eviction
+  if (result == GB_SUCCESS) { futimens(fd, NULL); }
+  close(fd);
+
+  return result;
+}
+
+GB_result_t GB_state_cache_store(const GB_state_cache_t *cache, const GB_state_cache_key_t *key, GB_emulator_t *gb) {
+  if (!gb)                                 { return GB_ERROR_INVALID_EMULATOR; }
+  if (!cache || !cache->directory || !key) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  char path[PATH_MAX], temp_path[PATH_MAX];
+  if (!entry_path(path, cache, key) || snprintf(temp_path, PATH_MAX, "%s.XXXXXX", path) >= PATH_MAX) {
+    return GB_ERROR_INVALID_ARGUMENT;
+  }
+
+  const size_t state_size = GB_emulator_state_size(gb);
+  uint8_t *state = malloc(state_size);
+  uint8_t *file = malloc(sizeof(GB_state_cache_header_t) + GB_rle_encoded_size_bound(state_size));
+  size_t written = 0;
+  GB_result_t result = state && file ? GB_emulator_save_state(gb, state, state_size, &written) : GB_ERROR_OUT_OF_MEMORY;
+  if (result == GB_SUCCESS) {
+    uint8_t *encoded = file + sizeof(GB_state_cache_header_t);
+    const size_t encoded_size = GB_rle_encode(encoded, state, NULL, written);
+    const GB_state_cache_header_t header = {
+      .magic = GB_STATE_CACHE_MAGIC,
+      .version = GB_STATE_CACHE_VERSION,
+      .key = *key,
+      .state_size = (uint32_t)written,
+      .encoded_size = (uint32_t)encoded_size,
+      .crc = GB_hash_crc32(0, encoded, encoded_size)
+    };
+    memcpy(file, &header, sizeof(GB_state_cache_header_t));
+
+    // Jobs storing the same entry each write their own file, the last rename wins
+    const int fd = mkstemp(temp_path);
+    if (fd < 0) {
+      result = GB_ERROR_IO;
+    } else {
+      const bool complete = write_all(fd, file, sizeof(GB_state_cache_header_t) + encoded_size) && fchmod(fd, 0644) == 0;
+      if (close(fd) != 0 || !complete || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        result = GB_ERROR_IO;
+      }
+    }
+  }
+  free(file);
+  free(state);
+
+  if (result == GB_SUCCESS && cache->max_size != 0) { evict(cache); }
+
+  return result;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "defs.h"
+#include "hash.h"
+
+#define GB_STATE_CACHE_MAGIC    (0x43534247)  // "GBSC"
+#define GB_STATE_CACHE_VERSION  (1)
+
+;
+#pragma pack(push, 1)
+
+typedef struct {
+  uint8_t rom_sha1[GB_HASH_SHA1_SIZE];  // ROM image as mapped
+  uint64_t prefix_hash;                 // Whatever led from power-on to the state: frames, inputs, options
+} GB_state_cache_key_t;
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  GB_state_cache_key_t key;   // Checked on load, file names only carry it
+  uint32_t state_size;
+  uint32_t encoded_size;
+  uint32_t crc;               // CRC-32 of the encoded state
+} GB_state_cache_header_t;    // Followed by the RLE encoded save state
+
+#pragma pack(pop)
+
+typedef struct {
+  char *directory;            // One <rom sha1>-<prefix hash>.state file per entry
+  uint64_t max_size;          // Bytes of entries kept, least recently used ones go first, 0 keeps everything
+} GB_state_cache_t;           // Read-only once initialized, so threads and processes can share a directory
+
+// Creates the directory if needed
+GB_result_t GB_state_cache_init(GB_state_cache_t *cache, const char *directory, uint64_t max_size);
+GB_result_t GB_state_cache_free(GB_state_cache_t *cache);
+
+// Loads the entry of key into gb and marks it as used, GB_ERROR_STATE_CACHE_MISS when there's no valid one
+GB_result_t GB_state_cache_load(const GB_state_cache_t *cache, const GB_state_cache_key_t *key, GB_emulator_t *gb);
+
+// Saves gb as the entry of key, replacing it atomically, then evicts entries over max_size
+GB_result_t GB_state_cache_store(const GB_state_cache_t *cache, const GB_state_cache_key_t *key, GB_emulator_t *gb);
@@ -0,0 +1,139 @@
+#include "thread_pool.h"
+#include <unistd.h>
+
+static void run_jobs(GB_thread_pool_t *pool) {
+  for (;;) {
+    const uint32_t index = atomic_fetch_add(&pool->next_job, 1);
+    if (index >= pool->job_count) { break; }
+
+    pool->job(pool->context, index);
+
+    // Last finished job wakes up the caller
+    if (atomic_fetch_sub(&pool->remaining_jobs, 1) == 1) {
+      pthread_mutex_lock(&pool->mutex);
+      pthread_cond_broadcast(&pool->done_cond);
+      pthread_mutex_unlock(&pool->mutex);
+    }
+  }
+}
+
+static void *worker_main(void *arg) {
+  GB_thread_pool_t *pool = arg;
+  uint64_t seen_generation = 0;
+
+  pthread_mutex_lock(&pool->mutex);
+  for (;;) {
+    while (!pool->shutdown && pool->generation == seen_generation) {
+      pthread_cond_wait(&pool->work_cond, &pool->mutex);
+    }
+    if (pool->shutdown) { break; }
+
+    // Batch could be already finished by the other threads
+    seen_generation = pool->generation;
+    if (!pool->busy) { continue; }
+
+    pool->active_workers++;
+    pthread_mutex_unlock(&pool->mutex);
+
+    run_jobs(pool);
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->active_workers--;
+    if (pool->active_workers == 0) { pthread_cond_broadcast(&pool->done_cond); }
+  }
+  pthread_mutex_unlock(&pool->mutex);
+
+  return NULL;
+}
+
+uint32_t GB_thread_pool_default_size(void) {
+  const long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+  // The calling thread takes part in every batch, so it is not counted
+  return cpu_count > 1 ? (uint32_t)(cpu_count - 1) : 0;
+}
+
+GB_result_t GB_thread_pool_init(GB_thread_pool_t *pool, uint32_t thread_count) {
+  if (!pool) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  memset(pool, 0, sizeof(GB_thread_pool_t));
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+  atomic_init(&pool->next_job, 0);
+  atomic_init(&pool->remaining_jobs, 0);
+
+  if (thread_count == 0) { return GB_SUCCESS; }
+
+  pool->threads = calloc(thread_count, sizeof(pthread_t));
+  if (!pool->threads) {
+    GB_thread_pool_free(pool);
+    return GB_ERROR_OUT_OF_MEMORY;
+  }
+
+  for (uint32_t i = 0; i < thread_count; i++) {
+    if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) {
+      GB_thread_pool_free(pool);
+      return GB_ERROR_OUT_OF_MEMORY;
+    }
+    pool->thread_count++;
+  }
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_thread_pool_free(GB_thread_pool_t *pool) {
+  if (!pool) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->shutdown = true;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for (uint32_t i = 0; i < pool->thread_count; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+
+  free(pool->threads);
+  pool->threads = NULL;
+  pool->thread_count = 0;
+
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_mutex_destroy(&pool->mutex);
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_thread_pool_run(GB_thread_pool_t *pool, GB_thread_pool_job_t job, void *context, uint32_t job_count) {
+  if (!pool || !job) { return GB_ERROR_INVALID_ARGUMENT; }
+  if (job_count == 0) { return GB_SUCCESS; }
+
+  // Publish a new batch, only one batch can be in flight at a time
+  pthread_mutex_lock(&pool->mutex);
+  while (pool->busy) { pthread_cond_wait(&pool->done_cond, &pool->mutex); }
+  pool->busy = true;
+  pool->job = job;
+  pool->context = context;
+  pool->job_count = job_count;
+  atomic_store(&pool->remaining_jobs, job_count);
+  atomic_store(&pool->next_job, 0);
+  pool->generation++;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  // The caller works on the batch too
+  run_jobs(pool);
+
+  // Wait until every job is done and no worker still touches the batch,
+  // workers join only while the batch is marked as busy
+  pthread_mutex_lock(&pool->mutex);
+  while (atomic_load(&pool->remaining_jobs) > 0 || pool->active_workers > 0) {
+    pthread_cond_wait(&pool->done_cond, &pool->mutex);
+  }
+  pool->busy = false;
+  pthread_cond_broadcast(&pool->done_cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  return GB_SUCCESS;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "defs.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+typedef void (*GB_thread_pool_job_t)(void *context, uint32_t index);
+
+typedef struct {
+  pthread_t *threads;
+  uint32_t thread_count;
+  pthread_mutex_t mutex;
+  pthread_cond_t work_cond;     // Signaled when a new batch of jobs is published
+  pthread_cond_t done_cond;     // Signaled when a batch is finished or the pool becomes idle
+  GB_thread_pool_job_t job;
+  void *context;
+  uint32_t job_count;
+  atomic_uint next_job;
+  atomic_uint remaining_jobs;
+  uint32_t active_workers;
+  uint64_t generation;
+  bool busy;
+  bool shutdown;
+} GB_thread_pool_t;
+
+GB_result_t GB_thread_pool_init(GB_thread_pool_t *pool, uint32_t thread_count);
+GB_result_t GB_thread_pool_free(GB_thread_pool_t *pool);
+GB_result_t GB_thread_pool_run(GB_thread_pool_t *pool, GB_thread_pool_job_t job, void *context, uint32_t job_count);
+uint32_t GB_thread_pool_default_size(void);
@@ -5,6 +5,7 @@ static GB_result_t reset(GB_emulator_t *gb) {
   if (!gb) { return GB_ERROR_INVALID_EMULATOR; }
 
   gb->timer.div_counter = 0;
+  gb->timer.cycles = 0;
 
   return GB_SUCCESS;
 }
@@ -21,6 +22,7 @@ GB_result_t GB_timer_tick(GB_emulator_t *gb) {
   if (!gb)            { return GB_ERROR_INVALID_EMULATOR; }
   if (!gb->memory.io) { return GB_ERROR_INVALID_ARGUMENT; }
 
+  gb->timer.cycles++;
   const uint16_t prev_div_counter = gb->timer.div_counter;
   gb->timer.div_counter++;
   gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_DIV)] = gb->timer.div_counter >> 8;
@@ -4,6 +4,7 @@
 
 typedef struct {
   uint16_t div_counter;
+  uint64_t cycles;        // T-cycles since power on
 } GB_timer_t;
 
 GB_result_t GB_timer_init(GB_emulator_t *gb);
@@ -0,0 +1,201 @@
+#include "vec_env.h"
+#include "gb.h"  // IWYU pragma: keep
+
+static bool is_reset(const GB_vec_env_t *vec, uint32_t index) {
+  return !vec->resets || vec->resets[index];
+}
+
+static void write_observation(GB_vec_env_t *vec, uint32_t index) {
+  const uint8_t *previous = vec->previous_frames ? vec->previous_frames + (size_t)index * sizeof(vec->envs[index].ppu.framebuffer) : NULL;
+  uint8_t *out = vec->observations + index * vec->observation.size;
+  GB_observation_write(&vec->observation, vec->envs[index].ppu.framebuffer, previous, out);
+}
+
+static GB_result_t reset_env(GB_vec_env_t *vec, uint32_t index) {
+  // Restoring into the existing instance reuses its memory, nothing is allocated
+  GB_emulator_t *gb = &vec->envs[index];
+  GB_TRY(GB_emulator_reset_to(gb, vec->starts[index]));
+  if (vec->previous_frames) {
+    memcpy(vec->previous_frames + (size_t)index * sizeof(gb->ppu.framebuffer), gb->ppu.framebuffer, sizeof(gb->ppu.framebuffer));
+  }
+
+  return GB_joypad_set_buttons(gb, 0);
+}
+
+static GB_result_t begin_frame(GB_vec_env_t *vec, uint32_t index, uint32_t frame) {
+  // Only the frames that are observed are rendered, the last one or the last two with max pooling.
+  // Framebuffer is part of the state, so the frame before a single frame step is the last observed one
+  GB_emulator_t *gb = &vec->envs[index];
+  const uint32_t rendered = vec->previous_frames ? 2 : 1;
+  if (vec->previous_frames && frame + 1 == vec->frames) {
+    memcpy(vec->previous_frames + (size_t)index * sizeof(gb->ppu.framebuffer), gb->ppu.framebuffer, sizeof(gb->ppu.framebuffer));
+  }
+
+  return GB_ppu_set_render_skip(gb, frame + rendered < vec->frames);
+}
+
+static GB_result_t step_env(GB_vec_env_t *vec, uint32_t index) {
+  GB_emulator_t *gb = &vec->envs[index];
+  GB_TRY(GB_joypad_set_buttons(gb, vec->actions[index]));
+  for (uint32_t frame = 0; frame < vec->frames; frame++) {
+    GB_TRY(begin_frame(vec, index, frame));
+    GB_TRY(GB_emulator_run_frame(gb));
+  }
+
+  return GB_SUCCESS;
+}
+
+static GB_result_t step_batch(GB_vec_env_t *vec, uint32_t first, uint32_t count, GB_lanes_stats_t *stats) {
+  for (uint32_t i = first; i < first + count; i++) { GB_TRY(GB_joypad_set_buttons(&vec->envs[i], vec->actions[i])); }
+  for (uint32_t frame = 0; frame < vec->frames; frame++) {
+    for (uint32_t i = first; i < first + count; i++) { GB_TRY(begin_frame(vec, i, frame)); }
+    GB_TRY(GB_lanes_run_frame(&vec->envs[first], count, stats));
+  }
+
+  return GB_SUCCESS;
+}
+
+static void run_batch(void *context, uint32_t batch) {
+  GB_vec_env_t *vec = context;
+  const uint32_t first = batch * vec->batch_size;
+  const uint32_t count = vec->env_count - first < vec->batch_size ? vec->env_count - first : vec->batch_size;
+  const GB_result_t result = step_batch(vec, first, count, &vec->batch_stats[batch]);
+  for (uint32_t i = first; i < first + count; i++) {
+    vec->results[i] = result;
+    if (result == GB_SUCCESS && vec->observations) { write_observation(vec, i); }
+  }
+}
+
+static void run_env(void *context, uint32_t index) {
+  GB_vec_env_t *vec = context;
+  GB_result_t result = GB_SUCCESS;
+  if (vec->actions) {
+    result = step_env(vec, index);
+  } else if (is_reset(vec, index)) {
+    result = reset_env(vec, index);
+  }
+
+  vec->results[index] = result;
+  if (result == GB_SUCCESS && vec->observations) { write_observation(vec, index); }
+}
+
+static GB_result_t run(GB_vec_env_t *vec) {
+  // Lockstep only changes how steps run, every lane of a reset restores on its own
+  if (vec->actions && vec->lockstep) {
+    memset(vec->batch_stats, 0, vec->batch_count * sizeof(GB_lanes_stats_t));
+    GB_TRY(GB_thread_pool_run(&vec->pool, run_batch, vec, vec->batch_count));
+    for (uint32_t i = 0; i < vec->batch_count; i++) {
+      vec->lanes_stats.instrs += vec->batch_stats[i].instrs;
+      vec->lanes_stats.vector_instrs += vec->batch_stats[i].vector_instrs;
+    }
+  } else {
+    GB_TRY(GB_thread_pool_run(&vec->pool, run_env, vec, vec->env_count));
+  }
+
+  for (uint32_t i = 0; i < vec->env_count; i++) {
+    if (GB_FAILED(vec->results[i])) { return vec->results[i]; }
+  }
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_vec_env_init(GB_vec_env_t *vec, const GB_vec_env_config_t *config) {
+  if (!vec)                                              { return GB_ERROR_INVALID_ARGUMENT; }
+  memset(vec, 0, sizeof(GB_vec_env_t));
+  if (!config || !config->rom || config->env_count == 0) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  GB_TRY(GB_observation_init(&vec->observation, &config->observation));
+
+  // Pool comes next, so every later failure can be cleaned up by GB_vec_env_free
+  const uint32_t thread_count = config->thread_count ? config->thread_count : GB_thread_pool_default_size();
+  const GB_result_t pool_result = GB_thread_pool_init(&vec->pool, thread_count);
+  if (GB_FAILED(pool_result)) {
+    GB_observation_free(&vec->observation);
+    return pool_result;
+  }
+
+  vec->lockstep = config->lockstep;
+  vec->envs = calloc(config->env_count, sizeof(GB_emulator_t));
+  vec->starts = calloc(config->env_count, sizeof(GB_emulator_t *));
+  vec->random_states = calloc(config->env_count, sizeof(uint32_t));
+  vec->results = calloc(config->env_count, sizeof(GB_result_t));
+
+  // Lockstep spreads the environments over the threads first, vector steps are only shared within a batch
+  const uint32_t worker_count = vec->pool.thread_count + 1;
+  vec->batch_size = (config->env_count + worker_count - 1) / worker_count;
+  if (vec->batch_size > GB_LANES_MAX) { vec->batch_size = GB_LANES_MAX; }
+  vec->batch_count = (config->env_count + vec->batch_size - 1) / vec->batch_size;
+  vec->batch_stats = calloc(vec->batch_count, sizeof(GB_lanes_stats_t));
+  if (vec->observation.config.max_pool) { vec->previous_frames = calloc(config->env_count, sizeof(vec->envs->ppu.framebuffer)); }
+  if (!vec->envs || !vec->starts || !vec->random_states ||
+      !vec->results || !vec->batch_stats ||
+      (vec->observation.config.max_pool && !vec->previous_frames)) {
+    GB_vec_env_free(vec);
+    return GB_ERROR_OUT_OF_MEMORY;
+  }
+
+  GB_result_t result = GB_SUCCESS;
+  for (uint32_t i = 0; i < config->env_count && result == GB_SUCCESS; i++) {
+    result = GB_emulator_init(&vec->envs[i]);
+    vec->env_count++;
+    if (result == GB_SUCCESS) { result = GB_emulator_attach_rom(&vec->envs[i], config->rom); }
+    if (result == GB_SUCCESS && config->skip_boot) { result = GB_emulator_skip_boot(&vec->envs[i]); }
+  }
+
+  // All environments start from the same state, resets return to it unless a pool of start states is given
+  if (result == GB_SUCCESS) { result = GB_snapshot_pool_init(&vec->initial_state, 1); }
+  if (result == GB_SUCCESS) { result = GB_snapshot_pool_add(&vec->initial_state, &vec->envs[0]); }
+  vec->start_states = config->start_states ? config->start_states : &vec->initial_state;
+  if (result == GB_SUCCESS && vec->start_states->count == 0) { result = GB_ERROR_INVALID_ARGUMENT; }
+  for (uint32_t i = 0; i < vec->env_count; i++) { vec->random_states[i] = ((config->seed + i) * 0x9E3779B1u) | 1; }
+  if (GB_FAILED(result)) {
+    GB_vec_env_free(vec);
+    return result;
+  }
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_vec_env_free(GB_vec_env_t *vec) {
+  if (!vec) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  GB_thread_pool_free(&vec->pool);
+  for (uint32_t i = 0; i < vec->env_count; i++) { GB_emulator_free(&vec->envs[i]); }
+  free(vec->envs);
+  free(vec->starts);
+  free(vec->random_states);
+  free(vec->results);
+  free(vec->batch_stats);
+  free(vec->previous_frames);
+  GB_snapshot_pool_free(&vec->initial_state);
+  GB_observation_free(&vec->observation);
+  memset(vec, 0, sizeof(GB_vec_env_t));
+
+  return GB_SUCCESS;
+}
+
+GB_result_t GB_vec_env_step(GB_vec_env_t *vec, const uint8_t *actions, uint32_t frames, uint8_t *observations) {
+  if (!vec || !vec->envs)     { return GB_ERROR_INVALID_ARGUMENT; }
+  if (!actions || frames == 0) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  vec->actions = actions;
+  vec->resets = NULL;
+  vec->observations = observations;
+  vec->frames = frames;
+
+  return run(vec);
+}
+
+GB_result_t GB_vec_env_reset(GB_vec_env_t *vec, const uint8_t *resets, uint8_t *observations) {
+  if (!vec || !vec->envs) { return GB_ERROR_INVALID_ARGUMENT; }
+
+  vec->actions = NULL;
+  vec->resets = resets;
+  vec->observations = observations;
+  vec->frames = 0;
+  for (uint32_t i = 0; i < vec->env_count; i++) {
+    vec->starts[i] = is_reset(vec, i) ? GB_snapshot_pool_pick(vec->start_states, &vec->random_states[i]) : NULL;
+  }
+
+  return run(vec);
+}
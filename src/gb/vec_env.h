@@ -0,0 +1,56 @@
+#pragma once
+
+#include "defs.h"
+#include "thread_pool.h"
+#include "observation.h"
+#include "snapshot.h"
+#include "lanes.h"
+
+typedef struct {
+  GB_rom_t *rom;                          // Every environment runs the same ROM image
+  uint32_t env_count;
+  uint32_t thread_count;                  // Worker threads besides the caller, 0 picks one per extra core
+  GB_observation_config_t observation;   // Zero keeps the full screen as shade indices
+  bool lockstep;                          // Experimental, steps run on GB_lanes_run_frame in batches of up to GB_LANES_MAX
+  bool skip_boot;                         // Environments start at $0100, see GB_emulator_skip_boot
+  const GB_snapshot_pool_t *start_states; // Resets start from one of them at random, NULL restarts the ROM
+  uint32_t seed;                          // Start state picks are reproducible for a seed
+} GB_vec_env_config_t;
+
+typedef struct {
+  GB_emulator_t *envs;
+  uint32_t env_count;
+  GB_observation_t observation;
+  uint8_t *previous_frames;               // Frame before the last of every environment, only with max_pool
+  GB_snapshot_pool_t initial_state;       // Fork taken right after the ROM was attached
+  const GB_snapshot_pool_t *start_states; // Pool resets pick from, initial_state by default
+  const GB_emulator_t **starts;           // Start state of every lane reset by the running call
+  uint32_t *random_states;
+  GB_result_t *results;                   // Status of every environment in the last call
+  GB_thread_pool_t pool;
+
+  // Lockstep batches of consecutive environments, one pool job each
+  bool lockstep;
+  uint32_t batch_size;
+  uint32_t batch_count;
+  GB_lanes_stats_t *batch_stats;
+  GB_lanes_stats_t lanes_stats;           // Sum over all steps so far
+
+  // Arguments of the running call, read by the pool jobs
+  const uint8_t *actions;
+  const uint8_t *resets;
+  uint8_t *observations;
+  uint32_t frames;
+} GB_vec_env_t;
+
+GB_result_t GB_vec_env_init(GB_vec_env_t *vec, const GB_vec_env_config_t *config);
+GB_result_t GB_vec_env_free(GB_vec_env_t *vec);
+
+// Holds actions[i] (GB_JOYPAD_* mask) on environment i for the given frames, then writes its
+// observation to observations + i * vec->observation.size, observations may be NULL
+GB_result_t GB_vec_env_step(GB_vec_env_t *vec, const uint8_t *actions, uint32_t frames, uint8_t *observations);
+
+// Restarts the environments with a nonzero resets[i], or all of them when resets is NULL,
+// and writes the observation of every environment. A restart copies back only the memory
+// pages the environment wrote, see GB_emulator_reset_to
+GB_result_t GB_vec_env_reset(GB_vec_env_t *vec, const uint8_t *resets, uint8_t *observations);
@@ -0,0 +1,20 @@
+#pragma once
+
+// Public interface of the emulator core (libgbplay), it doesn't depend on SDL
+
+// Bumped with any change of emulated behaviour, warm-up states cached by older versions are then unused
+#define GBPLAY_VERSION "1.0"
+
+#include "gb/gb.h"
+#include "gb/thread_pool.h"
+#include "gb/rewind.h"
+#include "gb/checkpoint.h"
+#include "gb/state_cache.h"
+#include "gb/hash.h"
+#include "gb/observation.h"
+#include "gb/scene.h"
+#include "gb/ram_watch.h"
+#include "gb/predicate.h"
+#include "gb/snapshot.h"
+#include "gb/lanes.h"
+#include "gb/vec_env.h"
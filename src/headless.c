@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include "log.h"
+#include "runner.h"
+#include "batch.h"
+#include "bench.h"
+#include "verify.h"
+
+#define DEFAULT_FRAMES            (600)   // Ten seconds of emulated time
+#define DEFAULT_STATE_CACHE_SIZE  (1024)  // MiB
+
+static void print_result(const run_result_t *result) {
+  const double seconds = result->seconds > 0.0 ? result->seconds : 1e-9;
+  const double emulated_seconds = (double)result->cycles / GB_CYCLES_PER_SECOND;
+  printf("frames: %llu\n", (unsigned long long)result->frames);
+  printf("cycles: %llu\n", (unsigned long long)result->cycles);
+  printf("hash: %016llx\n", (unsigned long long)result->hash);
+  if (result->matched) { printf("matched: yes\n"); }
+  for (size_t i = 0; i < result->frame_hash_count; i++) {
+    printf("frame hash %zu: %016llx\n", i, (unsigned long long)result->frame_hashes[i]);
+  }
+  if (result->serial_size > 0) { printf("serial: %.*s\n", (int)result->serial_size, result->serial); }
+  if (result->warmup_cached || result->warmup_seconds > 0.0) {
+    printf("warm-up: %s, %.3f s\n", result->warmup_cached ? "cached" : "emulated", result->warmup_seconds);
+  }
+  printf("time: %.3f s\n", result->seconds);
+  printf("speed: %.2f MHz, %.1f frames/s, %.2fx real time\n",
+         result->cycles / seconds / 1e6,
+         result->frames / seconds,
+         emulated_seconds / seconds);
+}
+
+static void print_help() {
+  printf("usage: [options] rom\n");
+  printf("       [options] --batch MANIFEST --results FILE\n\n");
+  printf("positional arguments:\n");
+  printf("  rom\t ROM path\n\n");
+  printf("options:\n");
+  printf("  -n, --frames N\t frames to run (default: %d, unlimited when only --cycles is given)\n", DEFAULT_FRAMES);
+  printf("  -C, --cycles N\t T-cycles to run\n");
+  printf("  -i, --input FILE\t scripted input, one \"FRAME BUTTON+BUTTON\" line per change, '-' releases all\n");
+  printf("  -o, --output FILE\t write the final framebuffer as PNG (.png) or PGM\n");
+  printf("  -u, --until EXPR\t stop at the instruction that makes a RAM predicate true, e.g. \"D35E == 0 || C0A0 >= 10\"\n");
+  printf("  -t, --rtc SOURCE\t cartridge clock follows the host or emulated time (default: emulated)\n");
+  printf("  -B, --skip-boot\t start the cartridge in its post-boot state instead of running the boot ROM\n");
+  printf("  -w, --warmup N\t run N frames of setup before the measured run, input frames count from power-on\n");
+  printf("  -S, --state-cache DIR\t reuse warm-up states saved in DIR across runs\n");
+  printf("  -z, --state-cache-size MB\t size the state cache is trimmed to (default: %d, 0 keeps everything)\n\n", DEFAULT_STATE_CACHE_SIZE);
+  printf("batch options:\n");
+  printf("  -b, --batch FILE\t run every job of a JSON lines manifest\n");
+  printf("  -r, --results FILE\t write one JSON line per finished job\n");
+  printf("  -j, --jobs N\t\t threads to run jobs on (default: one per core)\n");
+  printf("  -H, --hash-interval N\t record a framebuffer hash every N frames (default: none)\n\n");
+  printf("benchmark options:\n");
+  printf("  -V, --vec-bench N\t step N environments of the ROM with and without lockstep and compare\n");
+  printf("  -s, --obs-size WxH\t downsample observations to W x H (default: 160x144)\n");
+  printf("  -g, --grayscale\t observations are grayscale instead of shade indices\n");
+  printf("  -m, --max-pool\t observations are pooled over the last two frames\n\n");
+  printf("verification options:\n");
+  printf("  -v, --verify\t\t check that the pixel FIFO and the line renderer draw the same frames, and that\n");
+  printf("\t\t\t --skip-boot leaves the state the boot ROM leaves\n");
+}
+
+int main(int argc, char *argv[]) {
+  run_config_t config = { .rtc_source = GB_RTC_SOURCE_EMULATED, .capture_serial = true };
+  batch_config_t batch_config = { .default_frames = DEFAULT_FRAMES };
+  bench_config_t bench_config = { 0 };
+  bool verify = false;
+  const char *state_cache_path = NULL;
+  uint64_t state_cache_size = DEFAULT_STATE_CACHE_SIZE;
+  for (int i = 1; i < argc; i++) {
+    if ((!strcmp(argv[i], "-n") || !strcmp(argv[i], "--frames")) && (i + 1) < argc) {
+      config.max_frames = strtoull(argv[++i], NULL, 10);
+    } else if ((!strcmp(argv[i], "-C") || !strcmp(argv[i], "--cycles")) && (i + 1) < argc) {
+      config.max_cycles = strtoull(argv[++i], NULL, 10);
+    } else if ((!strcmp(argv[i], "-i") || !strcmp(argv[i], "--input")) && (i + 1) < argc) {
+      config.input_path = argv[++i];
+    } else if ((!strcmp(argv[i], "-o") || !strcmp(argv[i], "--output")) && (i + 1) < argc) {
+      config.output_path = argv[++i];
+    } else if ((!strcmp(argv[i], "-u") || !strcmp(argv[i], "--until")) && (i + 1) < argc) {
+      config.until = argv[++i];
+    } else if ((!strcmp(argv[i], "-t") || !strcmp(argv[i], "--rtc")) && (i + 1) < argc) {
+      config.rtc_source = !strcmp(argv[++i], "host") ? GB_RTC_SOURCE_HOST : GB_RTC_SOURCE_EMULATED;
+    } else if (!strcmp(argv[i], "-B") || !strcmp(argv[i], "--skip-boot")) {
+      config.skip_boot = true;
+    } else if ((!strcmp(argv[i], "-w") || !strcmp(argv[i], "--warmup")) && (i + 1) < argc) {
+      config.warmup_frames = strtoull(argv[++i], NULL, 10);
+    } else if ((!strcmp(argv[i], "-S") || !strcmp(argv[i], "--state-cache")) && (i + 1) < argc) {
+      state_cache_path = argv[++i];
+    } else if ((!strcmp(argv[i], "-z") || !strcmp(argv[i], "--state-cache-size")) && (i + 1) < argc) {
+      state_cache_size = strtoull(argv[++i], NULL, 10);
+    } else if ((!strcmp(argv[i], "-b") || !strcmp(argv[i], "--batch")) && (i + 1) < argc) {
+      batch_config.manifest_path = argv[++i];
+    } else if ((!strcmp(argv[i], "-r") || !strcmp(argv[i], "--results")) && (i + 1) < argc) {
+      batch_config.results_path = argv[++i];
+    } else if ((!strcmp(argv[i], "-j") || !strcmp(argv[i], "--jobs")) && (i + 1) < argc) {
+      batch_config.thread_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if ((!strcmp(argv[i], "-H") || !strcmp(argv[i], "--hash-interval")) && (i + 1) < argc) {
+      config.hash_interval = strtoull(argv[++i], NULL, 10);
+    } else if ((!strcmp(argv[i], "-V") || !strcmp(argv[i], "--vec-bench")) && (i + 1) < argc) {
+      bench_config.env_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if ((!strcmp(argv[i], "-s") || !strcmp(argv[i], "--obs-size")) && (i + 1) < argc) {
+      unsigned width = 0;
+      unsigned height = 0;
+      sscanf(argv[++i], "%ux%u", &width, &height);
+      bench_config.observation.width = (uint16_t)width;
+      bench_config.observation.height = (uint16_t)height;
+    } else if (!strcmp(argv[i], "-g") || !strcmp(argv[i], "--grayscale")) {
+      bench_config.observation.color = GB_OBSERVATION_GRAYSCALE;
+    } else if (!strcmp(argv[i], "-m") || !strcmp(argv[i], "--max-pool")) {
+      bench_config.observation.max_pool = true;
+    } else if (!strcmp(argv[i], "-v") || !strcmp(argv[i], "--verify")) {
+      verify = true;
+    } else if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+      print_help();
+      return EXIT_SUCCESS;
+    } else {
+      config.rom_path = argv[i];
+    }
+  }
+
+  if (batch_config.manifest_path) {
+    if (!batch_config.results_path) {
+      LOG_ERROR("batch mode needs a results file.");
+      print_help();
+      return EXIT_FAILURE;
+    }
+
+    // Frame and cycle limits on the command line are defaults for the jobs
+    batch_config.hash_interval = config.hash_interval;
+    batch_config.rtc_source = config.rtc_source;
+    batch_config.skip_boot = config.skip_boot;
+    batch_config.warmup_frames = config.warmup_frames;
+    batch_config.state_cache_path = state_cache_path;
+    batch_config.state_cache_size = state_cache_size << 20;
+    if (config.max_frames != 0 || config.max_cycles != 0) { batch_config.default_frames = config.max_frames; }
+    batch_config.default_cycles = config.max_cycles;
+
+    return run_batch(&batch_config) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (!config.rom_path) {
+    LOG_ERROR("invalid ROM specified.");
+    print_help();
+    return EXIT_FAILURE;
+  }
+  if (config.max_frames == 0 && config.max_cycles == 0) { config.max_frames = DEFAULT_FRAMES; }
+
+  if (verify) {
+    const verify_config_t verify_config = { .rom_path = config.rom_path, .frames = config.max_frames, .skip_boot = config.skip_boot };
+    return run_verify(&verify_config) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (bench_config.env_count > 0) {
+    bench_config.rom_path = config.rom_path;
+    bench_config.thread_count = batch_config.thread_count;
+    bench_config.skip_boot = config.skip_boot;
+    bench_config.frames = config.max_frames ? config.max_frames : DEFAULT_FRAMES;
+    return run_vec_bench(&bench_config) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  GB_state_cache_t state_cache;
+  if (state_cache_path) {
+    if (GB_FAILED(GB_state_cache_init(&state_cache, state_cache_path, state_cache_size << 20))) {
+      LOG_ERROR("failed to open state cache %s.", state_cache_path);
+      return EXIT_FAILURE;
+    }
+    config.state_cache = &state_cache;
+  }
+
+  run_result_t result;
+  const bool succeeded = run_rom(&config, &result);
+  if (!succeeded) { LOG_ERROR("%s.", result.error); }
+  if (succeeded || result.cycles > 0) { print_result(&result); }
+  run_result_free(&result);
+  if (state_cache_path) { GB_state_cache_free(&state_cache); }
+
+  return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
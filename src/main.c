@@ -5,13 +5,16 @@
 #include <math.h>
 #include <time.h>
 #include "log.h"
-#include "gb/gb.h"
+#include "gbplay.h"
 
 #define WINDOW_TITLE      ("GBPlay")
-#define WINDOW_WIDTH      (GB_SCREEN_WIDTH * 2)
-#define WINDOW_HEIGHT     (GB_SCREEN_HEIGHT * 2)
+#define WINDOW_SCALE      (2)
 #define TARGET_FPS        (59.73)
 #define TARGET_FRAME_TIME (1000.0 / TARGET_FPS)
+#define REWIND_BUDGET_MB  (64)
+#define RUN_AHEAD_MAX     (8)
+#define RUN_AHEAD_STATS   (300)  // Frames between run-ahead cost reports
+#define BATTERY_SYNC_FRAMES (60)   // Frames between flushes of the battery save
 
 // Unused helpers
 #if defined(__GNUC__) || defined(__clang__)
@@ -27,6 +30,26 @@ static GB_emulator_t  g_emulator;
 static uint32_t       g_framebuffer[GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT];
 static uint32_t       g_gb_lcd_2_rgb_palette[4];
 static double         g_next_frame_time;
+static uint32_t       g_window_scale = WINDOW_SCALE;
+static GB_thread_pool_t g_render_pool;
+static uint32_t       g_render_threads = 0;
+static bool           g_render_pool_enabled = false;
+static GB_rewind_t    g_rewind;
+static uint32_t       g_rewind_budget_mb = REWIND_BUDGET_MB;
+static bool           g_rewind_enabled = false;
+static uint32_t       g_run_ahead = 0;
+static uint8_t       *g_run_ahead_state = NULL;
+static size_t         g_run_ahead_state_capacity = 0;
+static uint8_t        g_run_ahead_framebuffer[GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT];
+static double         g_run_ahead_frame_ms = 0.0;
+static double         g_run_ahead_extra_ms = 0.0;
+static uint32_t       g_run_ahead_frames = 0;
+static GB_checkpoint_t g_checkpoint;
+static const char    *g_checkpoint_path = NULL;
+static bool           g_checkpoint_enabled = false;
+static uint32_t       g_battery_sync_frames = 0;
+static GB_rtc_source_t g_rtc_source = GB_RTC_SOURCE_HOST;
+static bool           g_skip_boot = false;
 
 double get_current_time_ms() {
   struct timespec ts;
@@ -79,45 +102,69 @@ int save_screenshot(const uint32_t *pixels, int width, int height, const char *f
 
 
 void handle_input(GB_emulator_t *gb) {
-  if (!gb || !gb->memory.io) { return; }
-
-  const uint8_t p1 = gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_P1JOYP)];
-  uint8_t joy = 0x0F;  // All buttons released (active low)
-  const bool select_d_pad   = !(p1 & (1 << 4));
-  const bool select_buttons = !(p1 & (1 << 5));
-  if (select_d_pad || select_buttons) {
-    const bool *keyboard = SDL_GetKeyboardState(NULL);
-
-    if (select_buttons) {
-      if (keyboard[SDL_SCANCODE_RETURN]) { joy &= ~(1 << 3); }  // Start
-      if (keyboard[SDL_SCANCODE_RSHIFT]) { joy &= ~(1 << 2); }  // Select
-      if (keyboard[SDL_SCANCODE_Z])      { joy &= ~(1 << 1); }  // B
-      if (keyboard[SDL_SCANCODE_X])      { joy &= ~(1 << 0); }  // A
-    }
+  if (!gb) { return; }
+
+  const bool *keyboard = SDL_GetKeyboardState(NULL);
+  uint8_t buttons = 0;
+  if (keyboard[SDL_SCANCODE_RETURN]) { buttons |= GB_JOYPAD_START;  }
+  if (keyboard[SDL_SCANCODE_RSHIFT]) { buttons |= GB_JOYPAD_SELECT; }
+  if (keyboard[SDL_SCANCODE_Z])      { buttons |= GB_JOYPAD_B;      }
+  if (keyboard[SDL_SCANCODE_X])      { buttons |= GB_JOYPAD_A;      }
+  if (keyboard[SDL_SCANCODE_DOWN])   { buttons |= GB_JOYPAD_DOWN;   }
+  if (keyboard[SDL_SCANCODE_UP])     { buttons |= GB_JOYPAD_UP;     }
+  if (keyboard[SDL_SCANCODE_LEFT])   { buttons |= GB_JOYPAD_LEFT;   }
+  if (keyboard[SDL_SCANCODE_RIGHT])  { buttons |= GB_JOYPAD_RIGHT;  }
+
+  if (keyboard[SDL_SCANCODE_P]) { save_screenshot(g_framebuffer, GB_SCREEN_WIDTH, GB_SCREEN_HEIGHT, "screenshot.bmp"); }
+
+  // Input is sampled once per frame
+  GB_joypad_set_buttons(gb, buttons);
+}
 
-    if (select_d_pad) {
-      if (keyboard[SDL_SCANCODE_DOWN])   { joy &= ~(1 << 3); }  // Down
-      if (keyboard[SDL_SCANCODE_UP])     { joy &= ~(1 << 2); }  // Up
-      if (keyboard[SDL_SCANCODE_LEFT])   { joy &= ~(1 << 1); }  // Left
-      if (keyboard[SDL_SCANCODE_RIGHT])  { joy &= ~(1 << 0); }  // Right
-    }
+GB_result_t run_ahead(GB_emulator_t *gb) {
+  const size_t state_size = GB_emulator_state_size(gb);
+  if (g_run_ahead_state_capacity < state_size) {
+    uint8_t *state = realloc(g_run_ahead_state, state_size);
+    if (!state) { return GB_ERROR_OUT_OF_MEMORY; }
+    g_run_ahead_state = state;
+    g_run_ahead_state_capacity = state_size;
+  }
+  GB_TRY(GB_emulator_save_state(gb, g_run_ahead_state, g_run_ahead_state_capacity, NULL));
 
-    if (keyboard[SDL_SCANCODE_P]) { save_screenshot(g_framebuffer, GB_SCREEN_WIDTH, GB_SCREEN_HEIGHT, "screenshot.bmp"); }
+  // Emulate ahead with the current input, only the last frame is rendered
+  for (uint32_t frame = 0; frame < g_run_ahead; frame++) {
+    GB_TRY(GB_ppu_set_render_skip(gb, frame + 1 < g_run_ahead));
+    GB_TRY(GB_emulator_run_frame(gb));
   }
+  memcpy(g_run_ahead_framebuffer, gb->ppu.framebuffer, sizeof(g_run_ahead_framebuffer));
 
-  gb->memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_P1JOYP)] = (p1 & 0xF0) | (joy & 0x0F);
+  // Back to the real timeline
+  GB_TRY(GB_ppu_set_render_skip(gb, false));
+  return GB_emulator_load_state(gb, g_run_ahead_state, state_size);
+}
 
-  // Trigger interrupt
-  if ((joy & 0x0F) != 0x0F) {
-    GB_interrupt_request(gb, GB_INTERRUPT_JOYPAD);
-  }
+void report_run_ahead_cost(double frame_ms, double extra_ms) {
+  g_run_ahead_frame_ms += frame_ms;
+  g_run_ahead_extra_ms += extra_ms;
+  if (++g_run_ahead_frames < RUN_AHEAD_STATS) { return; }
+
+  const double frame_avg = g_run_ahead_frame_ms / g_run_ahead_frames;
+  const double extra_avg = g_run_ahead_extra_ms / g_run_ahead_frames;
+  LOG_INFO("run-ahead %u: %.2f ms per frame + %.2f ms ahead (%.0f%% extra, %.0f%% of frame budget)",
+           g_run_ahead, frame_avg, extra_avg,
+           frame_avg > 0.0 ? 100.0 * extra_avg / frame_avg : 0.0,
+           100.0 * (frame_avg + extra_avg) / TARGET_FRAME_TIME);
+
+  g_run_ahead_frame_ms = 0.0;
+  g_run_ahead_extra_ms = 0.0;
+  g_run_ahead_frames = 0;
 }
 
-void render_frame() {
+void render_frame(const uint8_t *framebuffer) {
   if (!g_renderer || !g_frame) { return; }
 
   for (uint32_t i = 0; i < GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT; ++i) {
-    const uint8_t color = g_emulator.ppu.framebuffer[i];
+    const uint8_t color = framebuffer[i];
     g_framebuffer[i] = g_gb_lcd_2_rgb_palette[color & 0b11];
   }
 
@@ -152,22 +199,74 @@ void init_gb_lcd_2_rgb_palette() {
   }
 }
 
+void open_battery_save(GB_emulator_t *gb, const char *rom_path) {
+  if (!GB_battery_supported(gb)) { return; }
+
+  // Save file sits next to the ROM with a .sav extension
+  char sav_path[1024];
+  const char *extension = strrchr(rom_path, '.');
+  const char *separator = strrchr(rom_path, '/');
+  if (!extension || (separator && extension < separator)) { extension = rom_path + strlen(rom_path); }
+  if (snprintf(sav_path, sizeof(sav_path), "%.*s.sav", (int)(extension - rom_path), rom_path) >= (int)sizeof(sav_path)) {
+    LOG_WARNING("battery save path is too long, game saves are not kept.");
+    return;
+  }
+
+  if (GB_FAILED(GB_battery_open(gb, sav_path))) {
+    LOG_WARNING("failed to open battery save %s, game saves are not kept.", sav_path);
+  }
+}
+
 void log_error(GB_error_t error) {
   LOG_ERROR("%s (%d):%s:%d", error.message, error.code, error.file, error.line);
 }
 
 void print_help() {
-  printf("usage: [rom]\n\n");
+  printf("usage: [options] [rom]\n\n");
   printf("positional arguments:\n");
-  printf("  rom\t ROM path\n");
+  printf("  rom\t ROM path\n\n");
+  printf("options:\n");
+  printf("  -s, --scale N\t window scale factor (default: %d)\n", WINDOW_SCALE);
+  printf("  -r, --rewind MB\t rewind history budget, 0 disables rewind (default: %d)\n", REWIND_BUDGET_MB);
+  printf("  -a, --run-ahead N\t frames to run ahead to hide input lag, up to %d (default: 0)\n", RUN_AHEAD_MAX);
+  printf("  -c, --checkpoint PATH\t resume from and periodically save checkpoints to PATH.0 and PATH.1\n");
+  printf("  -t, --rtc SOURCE\t cartridge clock follows the host or emulated time (default: host)\n");
+  printf("  -B, --skip-boot\t start the cartridge in its post-boot state instead of running the boot ROM\n");
+  printf("  -R, --render-threads N\t rasterize frames line by line on N threads instead of the emulation thread (default: 0)\n");
 }
 
 SDL_AppResult SDL_AppInit(UNUSED_PARAM void **appstate, int argc, char *argv[]) {
-  SDL_SetAppMetadata(WINDOW_TITLE, "1.0", "gplay");
+  // Arguments
+  const char *rom_path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if ((!strcmp(argv[i], "-s") || !strcmp(argv[i], "--scale")) && (i + 1) < argc) {
+      const int scale = atoi(argv[++i]);
+      g_window_scale = scale > 0 ? (uint32_t)scale : WINDOW_SCALE;
+    } else if ((!strcmp(argv[i], "-r") || !strcmp(argv[i], "--rewind")) && (i + 1) < argc) {
+      const int budget = atoi(argv[++i]);
+      g_rewind_budget_mb = budget > 0 ? (uint32_t)budget : 0;
+    } else if ((!strcmp(argv[i], "-a") || !strcmp(argv[i], "--run-ahead")) && (i + 1) < argc) {
+      const int frames = atoi(argv[++i]);
+      g_run_ahead = frames > 0 ? (uint32_t)(frames < RUN_AHEAD_MAX ? frames : RUN_AHEAD_MAX) : 0;
+    } else if ((!strcmp(argv[i], "-c") || !strcmp(argv[i], "--checkpoint")) && (i + 1) < argc) {
+      g_checkpoint_path = argv[++i];
+    } else if ((!strcmp(argv[i], "-t") || !strcmp(argv[i], "--rtc")) && (i + 1) < argc) {
+      g_rtc_source = !strcmp(argv[++i], "emulated") ? GB_RTC_SOURCE_EMULATED : GB_RTC_SOURCE_HOST;
+    } else if (!strcmp(argv[i], "-B") || !strcmp(argv[i], "--skip-boot")) {
+      g_skip_boot = true;
+    } else if ((!strcmp(argv[i], "-R") || !strcmp(argv[i], "--render-threads")) && (i + 1) < argc) {
+      const int threads = atoi(argv[++i]);
+      g_render_threads = threads > 0 ? (uint32_t)threads : 0;
+    } else {
+      rom_path = argv[i];
+    }
+  }
+
+  SDL_SetAppMetadata(WINDOW_TITLE, GBPLAY_VERSION, "gplay");
   if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS)) { return SDL_APP_FAILURE; }
  
   // Main window
-  g_window = SDL_CreateWindow(WINDOW_TITLE, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_HIGH_PIXEL_DENSITY | SDL_WINDOW_VULKAN);
+  g_window = SDL_CreateWindow(WINDOW_TITLE, GB_SCREEN_WIDTH * g_window_scale, GB_SCREEN_HEIGHT * g_window_scale, SDL_WINDOW_HIGH_PIXEL_DENSITY | SDL_WINDOW_VULKAN);
   if (!g_window) { return SDL_APP_FAILURE; }
 
   // Default renderer
@@ -188,18 +287,71 @@ SDL_AppResult SDL_AppInit(UNUSED_PARAM void **appstate, int argc, char *argv[])
     return SDL_APP_FAILURE;
   }
 
+  // Window scale is applied by the GPU, so rasterizing on other cores only pays off on hosts
+  // where the pixel FIFO alone can't keep up, which is left to the user
+  if (g_render_threads > 0) {
+    if (GB_FAILED(GB_thread_pool_init(&g_render_pool, g_render_threads))) {
+      LOG_ERROR("failed to start render threads.");
+      return SDL_APP_FAILURE;
+    }
+    g_render_pool_enabled = true;
+    GB_ppu_set_render_pool(&g_emulator, &g_render_pool);
+  }
+
   // Load ROM
-  if (argc > 1) {
-    if (GB_FAILED(GB_emulator_load_rom(&g_emulator, argv[1]))) {
+  if (rom_path) {
+    if (GB_FAILED(GB_emulator_load_rom(&g_emulator, rom_path))) {
       log_error(GB_emulator_get_last_error(&g_emulator));
       return SDL_APP_FAILURE;
     }
+    if (g_skip_boot && GB_FAILED(GB_emulator_skip_boot(&g_emulator))) {
+      LOG_ERROR("failed to skip the boot ROM.");
+      return SDL_APP_FAILURE;
+    }
   } else {
     LOG_ERROR("invalid ROM specified.");
     print_help();
     return SDL_APP_FAILURE;
   }
 
+  // Cartridge RAM of battery-backed games persists between runs
+  GB_rtc_set_source(&g_emulator, g_rtc_source);
+  open_battery_save(&g_emulator, rom_path);
+
+  // Long sessions continue from the newest checkpoint that survived
+  if (g_checkpoint_path) {
+    const GB_result_t result = GB_checkpoint_resume(g_checkpoint_path, &g_emulator);
+    if (result == GB_SUCCESS) {
+      LOG_INFO("resumed from checkpoint %s.", g_checkpoint_path);
+    } else if (result != GB_ERROR_CHECKPOINT_NOT_FOUND) {
+      LOG_WARNING("failed to resume from checkpoint %s (%d), starting over.", g_checkpoint_path, result);
+    }
+
+    const GB_checkpoint_config_t checkpoint_config = {
+      .path = g_checkpoint_path,
+      .interval = GB_CHECKPOINT_DEFAULT_INTERVAL
+    };
+    if (GB_FAILED(GB_checkpoint_init(&g_checkpoint, &checkpoint_config))) {
+      LOG_ERROR("failed to start checkpoint writer.");
+      return SDL_APP_FAILURE;
+    }
+    g_checkpoint_enabled = true;
+  }
+
+  // Rewind history is compressed on its own thread
+  if (g_rewind_budget_mb > 0) {
+    const GB_rewind_config_t rewind_config = {
+      .memory_budget = (size_t)g_rewind_budget_mb * 1024 * 1024,
+      .keyframe_interval = GB_REWIND_DEFAULT_KEYFRAME_INTERVAL,
+      .max_frames = GB_REWIND_DEFAULT_MAX_FRAMES
+    };
+    if (GB_FAILED(GB_rewind_init(&g_rewind, &rewind_config))) {
+      LOG_ERROR("failed to allocate rewind history.");
+      return SDL_APP_FAILURE;
+    }
+    g_rewind_enabled = true;
+  }
+
   // Time
   g_next_frame_time = get_current_time_ms();
 
@@ -215,17 +367,54 @@ SDL_AppResult SDL_AppEvent(UNUSED_PARAM void *appstate, SDL_Event *event) {
 }
 
 SDL_AppResult SDL_AppIterate(UNUSED_PARAM void *appstate) {
-  // Simulation
-  for (uint32_t t_cycle = 0; t_cycle < GB_CYCLES_PER_FRAME; ++t_cycle) {
+  const bool *keyboard = SDL_GetKeyboardState(NULL);
+  const uint8_t *framebuffer = g_emulator.ppu.framebuffer;
+  if (g_rewind_enabled && keyboard[SDL_SCANCODE_BACKSPACE]) {
+    // Rewind one frame per host frame, the oldest frame stays on screen
+    const GB_result_t result = GB_rewind_pop(&g_rewind, &g_emulator);
+    if (GB_FAILED(result) && result != GB_ERROR_REWIND_EMPTY) {
+      LOG_ERROR("failed to rewind (%d).", result);
+      return SDL_APP_FAILURE;
+    }
+  } else {
+    // Simulation, the real frame is never shown with run-ahead unless it can be rewound to
     handle_input(&g_emulator);
-    if (GB_FAILED(GB_emulator_tick(&g_emulator))) {
+    const double frame_start = get_current_time_ms();
+    GB_ppu_set_render_skip(&g_emulator, g_run_ahead > 0 && !g_rewind_enabled);
+    if (GB_FAILED(GB_emulator_run_frame(&g_emulator))) {
       log_error(GB_emulator_get_last_error(&g_emulator));
       return SDL_APP_FAILURE;
     }
+    const double frame_end = get_current_time_ms();
+
+    // Only a state copy is made here, compression runs on the rewind thread
+    if (g_rewind_enabled && GB_FAILED(GB_rewind_push(&g_rewind, &g_emulator))) {
+      LOG_WARNING("failed to record rewind frame.");
+    }
+
+    // Game saves are flushed only a few times per second, never on each RAM write
+    if (++g_battery_sync_frames >= BATTERY_SYNC_FRAMES) {
+      g_battery_sync_frames = 0;
+      if (GB_FAILED(GB_battery_sync(&g_emulator, false))) { LOG_WARNING("failed to flush battery save."); }
+    }
+
+    // Checkpoints are written to disk on their own thread
+    if (g_checkpoint_enabled && GB_FAILED(GB_checkpoint_push(&g_checkpoint, &g_emulator, false))) {
+      LOG_WARNING("failed to record checkpoint.");
+    }
+
+    if (g_run_ahead > 0) {
+      if (GB_FAILED(run_ahead(&g_emulator))) {
+        log_error(GB_emulator_get_last_error(&g_emulator));
+        return SDL_APP_FAILURE;
+      }
+      framebuffer = g_run_ahead_framebuffer;
+      report_run_ahead_cost(frame_end - frame_start, get_current_time_ms() - frame_end);
+    }
   }
 
   // Host render
-  render_frame();
+  render_frame(framebuffer);
 
   // VSync
   const double current_time = get_current_time_ms();
@@ -241,8 +430,29 @@ SDL_AppResult SDL_AppIterate(UNUSED_PARAM void *appstate) {
 }
 
 void SDL_AppQuit(UNUSED_PARAM void *appstate, UNUSED_PARAM SDL_AppResult result) {
+  if (g_checkpoint_enabled) {
+    // Final checkpoint, the writer finishes it before exiting
+    GB_checkpoint_push(&g_checkpoint, &g_emulator, true);
+    GB_checkpoint_free(&g_checkpoint);
+    g_checkpoint_enabled = false;
+  }
+
+  if (g_rewind_enabled) {
+    GB_rewind_free(&g_rewind);
+    g_rewind_enabled = false;
+  }
+
   GB_emulator_free(&g_emulator);
 
+  free(g_run_ahead_state);
+  g_run_ahead_state = NULL;
+  g_run_ahead_state_capacity = 0;
+
+  if (g_render_pool_enabled) {
+    GB_thread_pool_free(&g_render_pool);
+    g_render_pool_enabled = false;
+  }
+
   if (g_frame) {
     SDL_DestroyTexture(g_frame);
     g_frame = NULL;
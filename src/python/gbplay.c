@@ -0,0 +1,354 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "gbplay.h"
+
+// CPython bindings of the core. Memory regions are exported as read-only views of the
+// emulator's own buffers, and frames run with the GIL released
+
+typedef struct {
+  PyObject_HEAD
+  GB_emulator_t gb;
+  bool initialized;
+  bool running;             // Set while the GIL is released, other threads must not touch the emulator
+} emulator_object_t;
+
+typedef struct {
+  PyObject_HEAD
+  emulator_object_t *owner; // Kept alive by every view of the region
+  uint8_t *data;
+  int ndim;
+  Py_ssize_t shape[2];
+  Py_ssize_t strides[2];
+} region_object_t;
+
+static PyObject *g_error;
+
+static PyObject *raise_result(emulator_object_t *self, GB_result_t result) {
+  const GB_error_t error = self ? GB_emulator_get_last_error(&self->gb) : (GB_error_t){ 0 };
+  if (error.code != GB_SUCCESS) {
+    PyErr_Format(g_error, "%s (%d)", error.message, error.code);
+  } else {
+    PyErr_Format(g_error, "emulator failed (%d)", result);
+  }
+
+  return NULL;
+}
+
+static bool check_ready(emulator_object_t *self) {
+  if (!self->initialized) {
+    PyErr_SetString(PyExc_RuntimeError, "emulator is not initialized");
+    return false;
+  }
+  if (self->running) {
+    PyErr_SetString(PyExc_RuntimeError, "emulator is running in another thread");
+    return false;
+  }
+
+  return true;
+}
+
+// Region
+
+static int region_getbuffer(PyObject *object, Py_buffer *view, int flags) {
+  region_object_t *self = (region_object_t *)object;
+  if (flags & PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "emulator memory is read-only");
+    view->obj = NULL;
+    return -1;
+  }
+
+  view->buf = self->data;
+  view->obj = Py_NewRef(object);
+  view->len = self->ndim == 2 ? self->shape[0] * self->shape[1] : self->shape[0];
+  view->readonly = 1;
+  view->itemsize = 1;
+  view->format = (flags & PyBUF_FORMAT) ? "B" : NULL;
+  view->ndim = self->ndim;
+  view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+  view->strides = (flags & PyBUF_STRIDES) ? self->strides : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+
+  return 0;
+}
+
+static void region_dealloc(PyObject *object) {
+  region_object_t *self = (region_object_t *)object;
+  Py_XDECREF(self->owner);
+  Py_TYPE(object)->tp_free(object);
+}
+
+static PyBufferProcs g_region_buffer = {
+  .bf_getbuffer = region_getbuffer,
+};
+
+static PyTypeObject g_region_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "gbplay._Region",
+  .tp_basicsize = sizeof(region_object_t),
+  .tp_dealloc = region_dealloc,
+  .tp_as_buffer = &g_region_buffer,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+};
+
+static PyObject *region_view(emulator_object_t *owner, uint8_t *data, Py_ssize_t rows, Py_ssize_t columns) {
+  if (!owner->initialized) {
+    PyErr_SetString(PyExc_RuntimeError, "emulator is not initialized");
+    return NULL;
+  }
+
+  region_object_t *region = PyObject_New(region_object_t, &g_region_type);
+  if (!region) { return NULL; }
+  region->owner = (emulator_object_t *)Py_NewRef(owner);
+  region->data = data;
+  region->ndim = rows > 0 ? 2 : 1;
+  region->shape[0] = rows > 0 ? rows : columns;
+  region->shape[1] = columns;
+  region->strides[0] = rows > 0 ? columns : 1;
+  region->strides[1] = 1;
+
+  PyObject *view = PyMemoryView_FromObject((PyObject *)region);
+  Py_DECREF(region);
+
+  return view;
+}
+
+// Emulator
+
+static int emulator_init(PyObject *object, PyObject *args, PyObject *kwargs) {
+  static char *keywords[] = { "rom", "rtc", "skip_boot", NULL };
+  emulator_object_t *self = (emulator_object_t *)object;
+  const char *rom_path = NULL;
+  const char *rtc = "emulated";
+  int skip_boot = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|sp", keywords, &rom_path, &rtc, &skip_boot)) { return -1; }
+  // Views point into the emulator's buffers, freeing them for a second __init__ would leave them dangling
+  if (self->initialized) {
+    PyErr_SetString(PyExc_RuntimeError, "emulator is already initialized");
+    return -1;
+  }
+
+  GB_result_t result = GB_emulator_init(&self->gb);
+  if (GB_FAILED(result)) {
+    raise_result(NULL, result);
+    return -1;
+  }
+  result = GB_emulator_load_rom(&self->gb, rom_path);
+  if (GB_FAILED(result)) {
+    PyErr_Format(g_error, "failed to load ROM %s (%d)", rom_path, result);
+  } else {
+    if (skip_boot) { result = GB_emulator_skip_boot(&self->gb); }
+    if (result == GB_SUCCESS) { result = GB_rtc_set_source(&self->gb, !strcmp(rtc, "host") ? GB_RTC_SOURCE_HOST : GB_RTC_SOURCE_EMULATED); }
+    if (GB_FAILED(result)) { raise_result(self, result); }
+  }
+
+  // Failed __init__ leaves the object uninitialized, so no view of it can exist yet
+  if (GB_FAILED(result)) {
+    GB_emulator_free(&self->gb);
+    return -1;
+  }
+  self->initialized = true;
+
+  return 0;
+}
+
+static void emulator_dealloc(PyObject *object) {
+  emulator_object_t *self = (emulator_object_t *)object;
+  if (self->initialized) { GB_emulator_free(&self->gb); }
+  Py_TYPE(object)->tp_free(object);
+}
+
+static PyObject *run(emulator_object_t *self, bool set_buttons, uint8_t buttons, unsigned long frames) {
+  if (!check_ready(self)) { return NULL; }
+
+  // Other Python threads keep running meanwhile, the flag keeps them off this emulator
+  GB_result_t result = GB_SUCCESS;
+  self->running = true;
+  Py_BEGIN_ALLOW_THREADS
+  if (set_buttons) { result = GB_joypad_set_buttons(&self->gb, buttons); }
+  for (unsigned long frame = 0; frame < frames && result == GB_SUCCESS; frame++) {
+    result = GB_emulator_run_frame(&self->gb);
+  }
+  Py_END_ALLOW_THREADS
+  self->running = false;
+
+  if (GB_FAILED(result)) { return raise_result(self, result); }
+  Py_RETURN_NONE;
+}
+
+static PyObject *emulator_run_frames(PyObject *object, PyObject *args, PyObject *kwargs) {
+  static char *keywords[] = { "frames", NULL };
+  unsigned long frames = 1;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|k", keywords, &frames)) { return NULL; }
+
+  return run((emulator_object_t *)object, false, 0, frames);
+}
+
+static PyObject *emulator_step(PyObject *object, PyObject *args, PyObject *kwargs) {
+  static char *keywords[] = { "buttons", "frames", NULL };
+  unsigned char buttons = 0;
+  unsigned long frames = 1;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "b|k", keywords, &buttons, &frames)) { return NULL; }
+
+  return run((emulator_object_t *)object, true, buttons, frames);
+}
+
+static PyObject *emulator_run_until(PyObject *object, PyObject *args, PyObject *kwargs) {
+  static char *keywords[] = { "predicate", "frames", NULL };
+  emulator_object_t *self = (emulator_object_t *)object;
+  const char *expression = NULL;
+  unsigned long frames = 1;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|k", keywords, &expression, &frames)) { return NULL; }
+  if (!check_ready(self)) { return NULL; }
+
+  GB_predicate_t predicate;
+  if (GB_FAILED(GB_predicate_init(&predicate, expression))) {
+    PyErr_Format(PyExc_ValueError, "invalid predicate %s", expression);
+    return NULL;
+  }
+
+  GB_result_t result = GB_SUCCESS;
+  bool matched = false;
+  self->running = true;
+  Py_BEGIN_ALLOW_THREADS
+  for (unsigned long frame = 0; frame < frames && result == GB_SUCCESS && !matched; frame++) {
+    result = GB_predicate_run_frame(&predicate, &self->gb, &matched);
+  }
+  Py_END_ALLOW_THREADS
+  self->running = false;
+  GB_predicate_free(&predicate);
+
+  if (GB_FAILED(result)) { return raise_result(self, result); }
+  return PyBool_FromLong(matched);
+}
+
+static PyObject *emulator_save_state(PyObject *object, PyObject *Py_UNUSED(args)) {
+  emulator_object_t *self = (emulator_object_t *)object;
+  if (!check_ready(self)) { return NULL; }
+
+  // State is written straight into the bytes object
+  const size_t size = GB_emulator_state_size(&self->gb);
+  PyObject *state = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)size);
+  if (!state) { return NULL; }
+
+  size_t written = 0;
+  const GB_result_t result = GB_emulator_save_state(&self->gb, PyBytes_AS_STRING(state), size, &written);
+  if (GB_FAILED(result)) {
+    Py_DECREF(state);
+    return raise_result(self, result);
+  }
+  if (written < size && _PyBytes_Resize(&state, (Py_ssize_t)written) < 0) { return NULL; }
+
+  return state;
+}
+
+static PyObject *emulator_load_state(PyObject *object, PyObject *args) {
+  emulator_object_t *self = (emulator_object_t *)object;
+  Py_buffer state;
+  if (!PyArg_ParseTuple(args, "y*", &state)) { return NULL; }
+  if (!check_ready(self)) {
+    PyBuffer_Release(&state);
+    return NULL;
+  }
+
+  const GB_result_t result = GB_emulator_load_state(&self->gb, state.buf, (size_t)state.len);
+  PyBuffer_Release(&state);
+  if (GB_FAILED(result)) { return raise_result(self, result); }
+  Py_RETURN_NONE;
+}
+
+static PyObject *emulator_get_framebuffer(PyObject *object, void *Py_UNUSED(closure)) {
+  emulator_object_t *self = (emulator_object_t *)object;
+  return region_view(self, self->gb.ppu.framebuffer, GB_SCREEN_HEIGHT, GB_SCREEN_WIDTH);
+}
+
+static PyObject *emulator_get_wram(PyObject *object, void *closure) {
+  // WRAM banks are separate pages, they stay in place as the bindings never fork and __init__ runs once
+  emulator_object_t *self = (emulator_object_t *)object;
+  const uint8_t page = GB_MEMORY_PAGE_WRAM + (uint8_t)(uintptr_t)closure;
+  return region_view(self, self->gb.memory.page_data[page], 0, GB_MEMORY_PAGE_SIZE);
+}
+
+static PyObject *emulator_get_hram(PyObject *object, void *Py_UNUSED(closure)) {
+  emulator_object_t *self = (emulator_object_t *)object;
+  return region_view(self, self->gb.memory.hram, 0, sizeof(self->gb.memory.arena->hram));
+}
+
+static PyObject *emulator_get_oam(PyObject *object, void *Py_UNUSED(closure)) {
+  emulator_object_t *self = (emulator_object_t *)object;
+  return region_view(self, self->gb.memory.oam, 0, sizeof(self->gb.memory.arena->oam));
+}
+
+static PyObject *emulator_get_cycles(PyObject *object, void *Py_UNUSED(closure)) {
+  emulator_object_t *self = (emulator_object_t *)object;
+  return PyLong_FromUnsignedLongLong(self->gb.timer.cycles);
+}
+
+static PyMethodDef g_emulator_methods[] = {
+  { "run_frames", (PyCFunction)(void (*)(void))emulator_run_frames, METH_VARARGS | METH_KEYWORDS, "run_frames(frames=1)\n\nRuns frames with the GIL released." },
+  { "step", (PyCFunction)(void (*)(void))emulator_step, METH_VARARGS | METH_KEYWORDS, "step(buttons, frames=1)\n\nHolds a mask of buttons and runs frames with the GIL released." },
+  { "run_until", (PyCFunction)(void (*)(void))emulator_run_until, METH_VARARGS | METH_KEYWORDS, "run_until(predicate, frames=1) -> bool\n\nRuns up to frames frames and stops right after the instruction that makes the predicate true, which is returned. A call right after a match runs on instead of stopping at once." },
+  { "save_state", emulator_save_state, METH_NOARGS, "save_state() -> bytes" },
+  { "load_state", emulator_load_state, METH_VARARGS, "load_state(state)\n\nRestores a state from any bytes-like object." },
+  { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef g_emulator_getset[] = {
+  { "framebuffer", emulator_get_framebuffer, NULL, "144 x 160 read-only view of shade indices 0-3", NULL },
+  { "wram0", emulator_get_wram, NULL, "Read-only view of WRAM bank 0, $C000:$CFFF", (void *)0 },
+  { "wram1", emulator_get_wram, NULL, "Read-only view of WRAM bank 1, $D000:$DFFF", (void *)1 },
+  { "hram", emulator_get_hram, NULL, "Read-only view of HRAM, $FF80:$FFFE", NULL },
+  { "oam", emulator_get_oam, NULL, "Read-only view of OAM, $FE00:$FE9F", NULL },
+  { "cycles", emulator_get_cycles, NULL, "T-cycles since power on", NULL },
+  { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyTypeObject g_emulator_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "gbplay.Emulator",
+  .tp_doc = "Emulator(rom, rtc='emulated', skip_boot=False)\n\nIt can't be initialized twice, views of its memory stay valid as long as they are referenced, "
+            "they show the current contents and must not be read while another thread runs the emulator.",
+  .tp_basicsize = sizeof(emulator_object_t),
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_new = PyType_GenericNew,
+  .tp_init = emulator_init,
+  .tp_dealloc = emulator_dealloc,
+  .tp_methods = g_emulator_methods,
+  .tp_getset = g_emulator_getset,
+};
+
+// Module
+
+static struct PyModuleDef g_module = {
+  PyModuleDef_HEAD_INIT,
+  .m_name = "gbplay",
+  .m_doc = "Game Boy emulator core",
+  .m_size = -1,
+};
+
+PyMODINIT_FUNC PyInit_gbplay(void) {
+  if (PyType_Ready(&g_region_type) < 0)   { return NULL; }
+  if (PyType_Ready(&g_emulator_type) < 0) { return NULL; }
+
+  PyObject *module = PyModule_Create(&g_module);
+  if (!module) { return NULL; }
+
+  g_error = PyErr_NewException("gbplay.Error", NULL, NULL);
+  if (PyModule_AddObjectRef(module, "Error", g_error) < 0 ||
+      PyModule_AddObjectRef(module, "Emulator", (PyObject *)&g_emulator_type) < 0 ||
+      PyModule_AddStringConstant(module, "VERSION", GBPLAY_VERSION) < 0 ||
+      PyModule_AddIntConstant(module, "RIGHT", GB_JOYPAD_RIGHT) < 0 ||
+      PyModule_AddIntConstant(module, "LEFT", GB_JOYPAD_LEFT) < 0 ||
+      PyModule_AddIntConstant(module, "UP", GB_JOYPAD_UP) < 0 ||
+      PyModule_AddIntConstant(module, "DOWN", GB_JOYPAD_DOWN) < 0 ||
+      PyModule_AddIntConstant(module, "A", GB_JOYPAD_A) < 0 ||
+      PyModule_AddIntConstant(module, "B", GB_JOYPAD_B) < 0 ||
+      PyModule_AddIntConstant(module, "SELECT", GB_JOYPAD_SELECT) < 0 ||
+      PyModule_AddIntConstant(module, "START", GB_JOYPAD_START) < 0) {
+    Py_XDECREF(g_error);
+    Py_DECREF(module);
+    return NULL;
+  }
+
+  return module;
+}
@@ -0,0 +1,406 @@
+#include "runner.h"
+#include <stdlib.h>
+#include <strings.h>
+#include <time.h>
+
+#define INPUT_LINE_MAX   (256)
+
+typedef struct {
+  uint64_t frame;    // First frame the buttons are held on
+  uint8_t buttons;   // GB_JOYPAD_* mask, held until the next event
+} input_event_t;
+
+typedef struct {
+  input_event_t *events;
+  size_t count;
+  size_t capacity;
+} input_script_t;
+
+static const struct {
+  const char *name;
+  uint8_t mask;
+} BUTTON_NAMES[] = {
+  { "RIGHT",  GB_JOYPAD_RIGHT  },
+  { "LEFT",   GB_JOYPAD_LEFT   },
+  { "UP",     GB_JOYPAD_UP     },
+  { "DOWN",   GB_JOYPAD_DOWN   },
+  { "A",      GB_JOYPAD_A      },
+  { "B",      GB_JOYPAD_B      },
+  { "SELECT", GB_JOYPAD_SELECT },
+  { "START",  GB_JOYPAD_START  },
+};
+
+static bool parse_buttons(char *text, uint8_t *buttons) {
+  // Names joined with '+', '-' releases everything
+  *buttons = 0;
+  if (!strcmp(text, "-")) { return true; }
+
+  for (char *name = strtok(text, "+"); name; name = strtok(NULL, "+")) {
+    bool found = false;
+    for (size_t i = 0; i < sizeof(BUTTON_NAMES) / sizeof(BUTTON_NAMES[0]); i++) {
+      if (!strcasecmp(name, BUTTON_NAMES[i].name)) {
+        *buttons |= BUTTON_NAMES[i].mask;
+        found = true;
+        break;
+      }
+    }
+    if (!found) { return false; }
+  }
+
+  return true;
+}
+
+static bool load_input_script(const char *path, input_script_t *script, char *error) {
+  // One "FRAME BUTTONS" event per line in frame order, '#' starts a comment
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    snprintf(error, RUNNER_ERROR_MAX_LENGTH, "failed to open input script %s", path);
+    return false;
+  }
+
+  char line[INPUT_LINE_MAX];
+  uint32_t line_number = 0;
+  bool valid = true;
+  while (valid && fgets(line, sizeof(line), file)) {
+    line_number++;
+    char *comment = strchr(line, '#');
+    if (comment) { *comment = '\0'; }
+
+    unsigned long long frame;
+    char buttons_text[INPUT_LINE_MAX];
+    const int fields = sscanf(line, "%llu %255s", &frame, buttons_text);
+    if (fields == EOF) { continue; }  // Blank or comment-only line, anything else has to be an event
+
+    uint8_t buttons = 0;
+    valid = fields == 2 &&
+            parse_buttons(buttons_text, &buttons) &&
+            (script->count == 0 || frame >= script->events[script->count - 1].frame);
+    if (!valid) {
+      snprintf(error, RUNNER_ERROR_MAX_LENGTH, "invalid input event at %s:%u", path, line_number);
+      break;
+    }
+
+    if (script->count == script->capacity) {
+      const size_t capacity = script->capacity ? script->capacity * 2 : 64;
+      input_event_t *events = realloc(script->events, capacity * sizeof(input_event_t));
+      if (!events) {
+        snprintf(error, RUNNER_ERROR_MAX_LENGTH, "out of memory");
+        valid = false;
+        break;
+      }
+      script->events = events;
+      script->capacity = capacity;
+    }
+    script->events[script->count++] = (input_event_t){ .frame = frame, .buttons = buttons };
+  }
+  fclose(file);
+
+  return valid;
+}
+
+static uint8_t shade_to_gray(uint8_t shade) {
+  return 255 - (shade & 0x03) * 85;
+}
+
+static void write_be32(uint8_t *out, uint32_t value) {
+  out[0] = value >> 24;
+  out[1] = value >> 16;
+  out[2] = value >> 8;
+  out[3] = value;
+}
+
+static bool write_png_chunk(FILE *file, const char *type, const uint8_t *data, uint32_t size) {
+  uint8_t header[8], footer[4];
+  write_be32(header, size);
+  memcpy(header + 4, type, 4);
+  write_be32(footer, GB_hash_crc32(GB_hash_crc32(0, type, 4), data, size));
+
+  return fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+         (size == 0 || fwrite(data, 1, size, file) == size) &&
+         fwrite(footer, 1, sizeof(footer), file) == sizeof(footer);
+}
+
+static bool write_png(FILE *file, const uint8_t *framebuffer) {
+  // 8-bit grayscale, the image data is a zlib stream of stored blocks, one per row
+  enum { ROW_SIZE = 1 + GB_SCREEN_WIDTH, BLOCK_SIZE = 5 + ROW_SIZE };
+  static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  uint8_t header[13] = { 0 };
+  write_be32(header, GB_SCREEN_WIDTH);
+  write_be32(header + 4, GB_SCREEN_HEIGHT);
+  header[8] = 8;  // Bit depth, color type 0 is grayscale
+
+  uint8_t data[2 + GB_SCREEN_HEIGHT * BLOCK_SIZE + 4];
+  uint8_t *cursor = data;
+  *cursor++ = 0x78;  // Deflate with a 32K window, no compression
+  *cursor++ = 0x01;
+  uint32_t adler_a = 1, adler_b = 0;
+  for (uint32_t y = 0; y < GB_SCREEN_HEIGHT; y++) {
+    *cursor++ = y + 1 == GB_SCREEN_HEIGHT;  // Final block flag
+    *cursor++ = ROW_SIZE & 0xFF;
+    *cursor++ = ROW_SIZE >> 8;
+    *cursor++ = ~ROW_SIZE & 0xFF;
+    *cursor++ = (~ROW_SIZE >> 8) & 0xFF;
+
+    uint8_t *row = cursor;
+    *cursor++ = 0;  // No filter
+    for (uint32_t x = 0; x < GB_SCREEN_WIDTH; x++) {
+      *cursor++ = shade_to_gray(framebuffer[y * GB_SCREEN_WIDTH + x]);
+    }
+    for (uint32_t i = 0; i < ROW_SIZE; i++) {
+      adler_a = (adler_a + row[i]) % 65521;
+      adler_b = (adler_b + adler_a) % 65521;
+    }
+  }
+  write_be32(cursor, (adler_b << 16) | adler_a);
+  cursor += 4;
+
+  return fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+         write_png_chunk(file, "IHDR", header, sizeof(header)) &&
+         write_png_chunk(file, "IDAT", data, (uint32_t)(cursor - data)) &&
+         write_png_chunk(file, "IEND", NULL, 0);
+}
+
+static bool write_pgm(FILE *file, const uint8_t *framebuffer) {
+  uint8_t pixels[GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT];
+  for (uint32_t i = 0; i < GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT; i++) { pixels[i] = shade_to_gray(framebuffer[i]); }
+
+  return fprintf(file, "P5\n%d %d\n255\n", GB_SCREEN_WIDTH, GB_SCREEN_HEIGHT) > 0 &&
+         fwrite(pixels, 1, sizeof(pixels), file) == sizeof(pixels);
+}
+
+static bool save_framebuffer(const char *path, const uint8_t *framebuffer) {
+  // Format follows the extension, PGM unless it's .png
+  const char *extension = strrchr(path, '.');
+  const bool png = extension && !strcasecmp(extension, ".png");
+  FILE *file = fopen(path, "wb");
+  if (!file) { return false; }
+  const bool written = png ? write_png(file, framebuffer) : write_pgm(file, framebuffer);
+
+  return fclose(file) == 0 && written;
+}
+
+static double get_time_s(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool reserve(void **data, size_t *capacity, size_t count, size_t item_size) {
+  if (count < *capacity) { return true; }
+
+  const size_t new_capacity = *capacity ? *capacity * 2 : 64;
+  void *new_data = realloc(*data, new_capacity * item_size);
+  if (!new_data) { return false; }
+  *data = new_data;
+  *capacity = new_capacity;
+
+  return true;
+}
+
+typedef struct {
+  run_result_t *result;
+  size_t capacity;
+  bool failed;
+} serial_capture_t;
+
+static void capture_serial(void *context, uint8_t value) {
+  serial_capture_t *capture = context;
+  run_result_t *result = capture->result;
+  if (capture->failed || !reserve((void **)&result->serial, &capture->capacity, result->serial_size + 1, 1)) {
+    capture->failed = true;
+    return;
+  }
+  result->serial[result->serial_size++] = (char)value;
+  result->serial[result->serial_size] = '\0';
+}
+
+static void set_emulator_error(run_result_t *result, GB_emulator_t *gb, GB_result_t status) {
+  const GB_error_t error = GB_emulator_get_last_error(gb);
+  if (error.code == GB_SUCCESS) {
+    snprintf(result->error, RUNNER_ERROR_MAX_LENGTH, "emulator failed (%d)", status);
+  } else {
+    snprintf(result->error, RUNNER_ERROR_MAX_LENGTH, "%s (%d):%s:%d", error.message, error.code, error.file, error.line);
+  }
+}
+
+static GB_result_t apply_input(const input_script_t *script, size_t *next_event, uint64_t frame, GB_emulator_t *gb) {
+  // Latest event due by this frame, earlier ones on the same frame are skipped
+  if (*next_event >= script->count || script->events[*next_event].frame > frame) { return GB_SUCCESS; }
+  while (*next_event + 1 < script->count && script->events[*next_event + 1].frame <= frame) { (*next_event)++; }
+
+  return GB_joypad_set_buttons(gb, script->events[(*next_event)++].buttons);
+}
+
+static GB_result_t warm_up(const run_config_t *config, const input_script_t *script, GB_emulator_t *gb, run_result_t *result) {
+  // Entry is keyed by the ROM, the emulator version and everything that shapes the warm-up frames
+  GB_state_cache_key_t key;
+  uint8_t held_buttons = 0;
+  if (config->state_cache) {
+    if (config->rom_sha1) {
+      memcpy(key.rom_sha1, config->rom_sha1, GB_HASH_SHA1_SIZE);
+    } else {
+      GB_hash_sha1(gb->memory.rom->data, gb->memory.rom->size, key.rom_sha1);
+    }
+    const uint8_t options[2] = { config->skip_boot, (uint8_t)config->rtc_source };
+    uint64_t hash = GB_hash_fnv1a64(GB_HASH_FNV1A64_INIT, GBPLAY_VERSION, sizeof(GBPLAY_VERSION) - 1);
+    hash = GB_hash_fnv1a64(hash, &config->warmup_frames, sizeof(config->warmup_frames));
+    hash = GB_hash_fnv1a64(hash, options, sizeof(options));
+    for (size_t i = 0; i < script->count && script->events[i].frame < config->warmup_frames; i++) {
+      hash = GB_hash_fnv1a64(hash, &script->events[i].frame, sizeof(script->events[i].frame));
+      hash = GB_hash_fnv1a64(hash, &script->events[i].buttons, sizeof(script->events[i].buttons));
+      held_buttons = script->events[i].buttons;
+    }
+    key.prefix_hash = hash;
+
+    const GB_result_t status = GB_state_cache_load(config->state_cache, &key, gb);
+    if (status == GB_SUCCESS) {
+      // Held buttons aren't part of save states, they're set without the interrupt of a new press
+      gb->joypad.buttons = held_buttons;
+      result->warmup_cached = true;
+    }
+    if (status != GB_ERROR_STATE_CACHE_MISS) { return status; }
+  }
+
+  size_t next_event = 0;
+  GB_result_t status = GB_SUCCESS;
+  for (uint64_t frame = 0; frame < config->warmup_frames && status == GB_SUCCESS; frame++) {
+    status = apply_input(script, &next_event, frame, gb);
+    if (status == GB_SUCCESS) { status = GB_emulator_run_frame(gb); }
+  }
+
+  // Entries that can't be written only cost the next job its warm-up
+  if (status == GB_SUCCESS && config->state_cache) { GB_state_cache_store(config->state_cache, &key, gb); }
+
+  return status;
+}
+
+static uint64_t hash_state(GB_emulator_t *gb) {
+  const size_t size = GB_emulator_state_size(gb);
+  uint8_t *state = malloc(size);
+  size_t written = 0;
+  uint64_t hash = 0;
+  if (state && GB_emulator_save_state(gb, state, size, &written) == GB_SUCCESS) {
+    hash = GB_hash_fnv1a64(GB_HASH_FNV1A64_INIT, state, written);
+  }
+  free(state);
+
+  return hash;
+}
+
+bool run_rom(const run_config_t *config, run_result_t *result) {
+  memset(result, 0, sizeof(run_result_t));
+
+  input_script_t script = { 0 };
+  if (config->input_path && !load_input_script(config->input_path, &script, result->error)) {
+    free(script.events);
+    return false;
+  }
+
+  GB_emulator_t gb;
+  GB_result_t status = GB_emulator_init(&gb);
+  if (status == GB_SUCCESS) {
+    status = config->rom ? GB_emulator_attach_rom(&gb, config->rom) : GB_emulator_load_rom(&gb, config->rom_path);
+    if (status != GB_SUCCESS) {
+      snprintf(result->error, RUNNER_ERROR_MAX_LENGTH, "failed to load ROM %s (%d)", config->rom_path, status);
+      GB_emulator_free(&gb);
+      free(script.events);
+      return false;
+    }
+  }
+  if (status == GB_SUCCESS && config->skip_boot) { status = GB_emulator_skip_boot(&gb); }
+  if (status == GB_SUCCESS) { status = GB_rtc_set_source(&gb, config->rtc_source); }
+
+  GB_predicate_t until = { 0 };
+  if (status == GB_SUCCESS && config->until && GB_FAILED(GB_predicate_init(&until, config->until))) {
+    snprintf(result->error, RUNNER_ERROR_MAX_LENGTH, "invalid predicate %s", config->until);
+    GB_emulator_free(&gb);
+    free(script.events);
+    return false;
+  }
+
+  // Warm-up is setup, the job's limits, hashes, serial output and predicate start after it
+  size_t next_event = 0;
+  if (status == GB_SUCCESS && config->warmup_frames > 0) {
+    const double warmup_start_time = get_time_s(CLOCK_MONOTONIC);
+    status = warm_up(config, &script, &gb, result);
+    result->warmup_seconds = get_time_s(CLOCK_MONOTONIC) - warmup_start_time;
+    while (next_event < script.count && script.events[next_event].frame < config->warmup_frames) { next_event++; }
+  }
+
+  serial_capture_t capture = { .result = result };
+  if (status == GB_SUCCESS && config->capture_serial) { status = GB_serial_set_output(&gb, capture_serial, &capture); }
+
+  // Nothing but the emulation itself is timed
+  size_t frame_hash_capacity = 0;
+  bool out_of_memory = false;
+  const uint64_t start_cycles = gb.timer.cycles;
+  const double start_time = get_time_s(CLOCK_MONOTONIC);
+  const double start_cpu_time = get_time_s(CLOCK_THREAD_CPUTIME_ID);
+  while (status == GB_SUCCESS && !out_of_memory &&
+         (config->max_frames == 0 || result->frames < config->max_frames) &&
+         (config->max_cycles == 0 || gb.timer.cycles - start_cycles < config->max_cycles)) {
+    status = apply_input(&script, &next_event, config->warmup_frames + result->frames, &gb);
+    if (GB_FAILED(status)) { break; }
+
+    // Cycle budget ending inside a frame is finished tick by tick
+    if (config->max_cycles != 0 && config->max_cycles - (gb.timer.cycles - start_cycles) < GB_CYCLES_PER_FRAME) {
+      const uint32_t remaining_cycles = (uint32_t)(config->max_cycles - (gb.timer.cycles - start_cycles));
+      if (config->until) {
+        status = GB_predicate_run_cycles(&until, &gb, remaining_cycles, &result->matched);
+      } else {
+        gb.ppu.frame_ready = false;
+        for (uint32_t t_cycle = 0; t_cycle < remaining_cycles && status == GB_SUCCESS && !gb.ppu.frame_ready; ++t_cycle) {
+          status = GB_emulator_tick(&gb);
+        }
+      }
+      if (!gb.ppu.frame_ready && !result->matched) { continue; }
+    } else if (config->until) {
+      status = GB_predicate_run_frame(&until, &gb, &result->matched);
+    } else {
+      status = GB_emulator_run_frame(&gb);
+    }
+    // Frame a match ends in isn't complete, cycles tells where the run stopped
+    if (!result->matched || gb.ppu.frame_ready) { result->frames++; }
+    if (result->matched) { break; }
+
+    if (status == GB_SUCCESS && config->hash_interval != 0 && result->frames % config->hash_interval == 0) {
+      if (!reserve((void **)&result->frame_hashes, &frame_hash_capacity, result->frame_hash_count, sizeof(uint64_t))) {
+        out_of_memory = true;
+        break;
+      }
+      result->frame_hashes[result->frame_hash_count++] = GB_hash_fnv1a64(GB_HASH_FNV1A64_INIT, gb.ppu.framebuffer, sizeof(gb.ppu.framebuffer));
+    }
+  }
+  result->cpu_seconds = get_time_s(CLOCK_THREAD_CPUTIME_ID) - start_cpu_time;
+  result->seconds = get_time_s(CLOCK_MONOTONIC) - start_time;
+  result->cycles = gb.timer.cycles - start_cycles;
+  result->hash = GB_hash_fnv1a64(GB_HASH_FNV1A64_INIT, gb.ppu.framebuffer, sizeof(gb.ppu.framebuffer));
+  if (config->hash_state && status == GB_SUCCESS) { result->state_hash = hash_state(&gb); }
+
+  bool succeeded = status == GB_SUCCESS && !out_of_memory && !capture.failed;
+  if (status != GB_SUCCESS) {
+    set_emulator_error(result, &gb, status);
+  } else if (!succeeded) {
+    snprintf(result->error, RUNNER_ERROR_MAX_LENGTH, "out of memory");
+  } else if (config->output_path && !save_framebuffer(config->output_path, gb.ppu.framebuffer)) {
+    snprintf(result->error, RUNNER_ERROR_MAX_LENGTH, "failed to write framebuffer to %s", config->output_path);
+    succeeded = false;
+  }
+
+  GB_predicate_free(&until);
+  GB_emulator_free(&gb);
+  free(script.events);
+
+  return succeeded;
+}
+
+void run_result_free(run_result_t *result) {
+  if (!result) { return; }
+
+  free(result->frame_hashes);
+  free(result->serial);
+  result->frame_hashes = NULL;
+  result->frame_hash_count = 0;
+  result->serial = NULL;
+  result->serial_size = 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "gbplay.h"
+
+#define RUNNER_ERROR_MAX_LENGTH (GB_ERROR_MESSAGE_MAX_LENGTH + 64)
+
+typedef struct {
+  const char *rom_path;
+  GB_rom_t *rom;             // Shared ROM image, rom_path is loaded when NULL
+  const char *input_path;
+  const char *output_path;
+  uint64_t max_frames;       // 0 runs until max_cycles
+  uint64_t max_cycles;       // 0 runs until max_frames
+  uint64_t hash_interval;    // Frames between recorded framebuffer hashes, 0 records none
+  const char *until;         // Predicate that ends the run early, see GB_predicate_init
+  bool capture_serial;
+  bool hash_state;
+  bool skip_boot;            // Start at $0100 without running the boot ROM
+  uint64_t warmup_frames;    // Frames run before the job, input script frames count from power-on
+  const GB_state_cache_t *state_cache;  // Warm-up is loaded from and stored to it, NULL always runs it
+  const uint8_t *rom_sha1;   // SHA-1 of rom when the caller shares it across runs, computed per run when NULL
+  GB_rtc_source_t rtc_source;
+} run_config_t;
+
+typedef struct {
+  uint64_t frames;           // Completed frames, a match inside a frame doesn't count it
+  uint64_t cycles;
+  uint64_t hash;             // FNV-1a of the final framebuffer
+  uint64_t state_hash;       // FNV-1a of the final save state, when requested
+  uint64_t *frame_hashes;    // Framebuffer hash after every hash_interval frames
+  size_t frame_hash_count;
+  char *serial;              // Bytes sent through the serial port, when captured
+  size_t serial_size;
+  bool matched;              // Run ended because the until predicate became true
+  bool warmup_cached;        // Warm-up was loaded from the state cache
+  double warmup_seconds;     // Host time spent on the warm-up, not included in seconds
+  double seconds;            // Host time spent emulating
+  double cpu_seconds;        // CPU time of the running thread
+  char error[RUNNER_ERROR_MAX_LENGTH];
+} run_result_t;
+
+bool run_rom(const run_config_t *config, run_result_t *result);
+void run_result_free(run_result_t *result);
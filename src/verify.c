@@ -0,0 +1,166 @@
+#include "verify.h"
+#include "log.h"
+#include <stdlib.h>
+
+static uint32_t next_random(uint32_t *state) {
+  // xorshift32, both emulators of a check see the same buttons
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+
+  return x;
+}
+
+static bool init_emulator(GB_rom_t *rom, bool skip_boot, GB_emulator_t *gb) {
+  if (GB_FAILED(GB_emulator_init(gb))) { return false; }
+  if (GB_FAILED(GB_emulator_attach_rom(gb, rom)) ||
+      (skip_boot && GB_FAILED(GB_emulator_skip_boot(gb)))) {
+    GB_emulator_free(gb);
+    return false;
+  }
+
+  return true;
+}
+
+static bool init_pair(GB_rom_t *rom, bool skip_boot, GB_emulator_t *a, GB_emulator_t *b) {
+  if (!init_emulator(rom, skip_boot, a)) { return false; }
+  if (!init_emulator(rom, skip_boot, b)) {
+    GB_emulator_free(a);
+    return false;
+  }
+
+  return true;
+}
+
+static bool compare_states(GB_emulator_t *a, GB_emulator_t *b, const char *when) {
+  const size_t size = GB_emulator_state_size(a);
+  uint8_t *state_a = malloc(size);
+  uint8_t *state_b = malloc(size);
+  size_t written_a = 0;
+  size_t written_b = 0;
+  bool same = state_a && state_b &&
+              GB_emulator_save_state(a, state_a, size, &written_a) == GB_SUCCESS &&
+              GB_emulator_save_state(b, state_b, size, &written_b) == GB_SUCCESS;
+  if (!same) {
+    LOG_ERROR("failed to save the states %s.", when);
+  } else if (written_a != written_b || memcmp(state_a, state_b, written_a) != 0) {
+    size_t offset = 0;
+    while (offset < written_a && offset < written_b && state_a[offset] == state_b[offset]) { offset++; }
+    LOG_ERROR("states %s differ at byte %zu.", when, offset);
+    same = false;
+  }
+  free(state_b);
+  free(state_a);
+
+  return same;
+}
+
+static bool run_pair(GB_emulator_t *a, GB_emulator_t *b, uint64_t frames, uint64_t *frame) {
+  // Buttons change about every second, so games get past their title screens
+  uint32_t seed = 1;
+  for (*frame = 0; *frame < frames; (*frame)++) {
+    if (*frame % 60 == 0) {
+      const uint8_t buttons = (uint8_t)next_random(&seed);
+      GB_joypad_set_buttons(a, buttons);
+      GB_joypad_set_buttons(b, buttons);
+    }
+    if (GB_FAILED(GB_emulator_run_frame(a)) || GB_FAILED(GB_emulator_run_frame(b))) {
+      LOG_ERROR("frame %llu failed.", (unsigned long long)*frame);
+      return false;
+    }
+
+    // Frame cut short by the LCD being switched on ends in the middle of a line, which the pixel
+    // FIFO has partly drawn and the line renderer not at all, so only complete frames are compared
+    if (!a->ppu.frame_ready) { continue; }
+    for (uint32_t i = 0; i < GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT; i++) {
+      if (a->ppu.framebuffer[i] != b->ppu.framebuffer[i]) {
+        LOG_ERROR("frame %llu differs at %u,%u.", (unsigned long long)*frame, i % GB_SCREEN_WIDTH, i / GB_SCREEN_WIDTH);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+static bool verify_render(const verify_config_t *config, GB_rom_t *rom) {
+  // Pixel FIFO and the line renderer on the pool have to draw the same frames
+  GB_thread_pool_t pool;
+  if (GB_FAILED(GB_thread_pool_init(&pool, GB_thread_pool_default_size()))) {
+    LOG_ERROR("failed to create the render pool.");
+    return false;
+  }
+
+  GB_emulator_t fifo;
+  GB_emulator_t pooled;
+  if (!init_pair(rom, config->skip_boot, &fifo, &pooled)) {
+    LOG_ERROR("failed to create the emulators.");
+    GB_thread_pool_free(&pool);
+    return false;
+  }
+  GB_ppu_set_render_pool(&pooled, &pool);
+
+  uint64_t frame = 0;
+  const bool succeeded = run_pair(&fifo, &pooled, config->frames, &frame);
+  printf("render: %s, %llu frames\n", succeeded ? "ok" : "failed", (unsigned long long)frame);
+
+  GB_emulator_free(&pooled);
+  GB_emulator_free(&fifo);
+  GB_thread_pool_free(&pool);
+
+  return succeeded;
+}
+
+static bool verify_boot(const verify_config_t *config, GB_rom_t *rom) {
+  // GB_emulator_skip_boot has to leave the exact state the boot ROM leaves at $0100
+  GB_emulator_t booted;
+  GB_emulator_t skipped;
+  if (!init_pair(rom, false, &booted, &skipped)) {
+    LOG_ERROR("failed to create the emulators.");
+    return false;
+  }
+
+  bool succeeded = GB_emulator_skip_boot(&skipped) == GB_SUCCESS;
+  while (succeeded && booted.timer.cycles < skipped.timer.cycles) {
+    succeeded = GB_emulator_tick(&booted) == GB_SUCCESS;
+  }
+
+  // Boot ROM locks up on a bad logo and never hands over, there's nothing to compare then
+  const bool handed_over = booted.memory.io[GB_MEMORY_IO_OFFSET(GB_HARDWARE_REGISTER_BOOT)] != 0;
+  if (succeeded && !handed_over) {
+    printf("boot: skipped, the boot ROM rejects the cartridge header\n");
+  } else {
+    uint64_t frame = 0;
+    if (!succeeded) { LOG_ERROR("boot ROM failed or couldn't be skipped."); }
+    if (succeeded && booted.cpu.reg.pc != 0x0100) {
+      LOG_ERROR("boot ROM ended at $%04X instead of $0100 after %u cycles.", booted.cpu.reg.pc, GB_CYCLES_BOOT);
+      succeeded = false;
+    }
+    succeeded = succeeded && compare_states(&booted, &skipped, "at $0100");
+    succeeded = succeeded && run_pair(&booted, &skipped, config->frames, &frame);
+    succeeded = succeeded && compare_states(&booted, &skipped, "after the frames");
+    printf("boot: %s, %llu frames\n", succeeded ? "ok" : "failed", (unsigned long long)frame);
+  }
+
+  GB_emulator_free(&skipped);
+  GB_emulator_free(&booted);
+
+  return succeeded;
+}
+
+bool run_verify(const verify_config_t *config) {
+  GB_rom_t *rom = NULL;
+  if (GB_FAILED(GB_rom_load(&rom, config->rom_path))) {
+    LOG_ERROR("failed to load ROM %s.", config->rom_path);
+    return false;
+  }
+
+  // Every check runs, so one report covers them all
+  bool succeeded = verify_render(config, rom);
+  succeeded = verify_boot(config, rom) && succeeded;
+  GB_rom_release(rom);
+
+  return succeeded;
+}
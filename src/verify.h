@@ -0,0 +1,13 @@
+#pragma once
+
+#include "gbplay.h"
+
+typedef struct {
+  const char *rom_path;
+  uint64_t frames;          // Frames every check runs
+  bool skip_boot;
+} verify_config_t;
+
+// Runs the ROM through code paths that must produce the same emulation and prints one line per
+// check, returns false when any of them differ
+bool run_verify(const verify_config_t *config);